@@ -4,12 +4,51 @@
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <new>
+#include <random>
+
+#include <boost/lexical_cast.hpp>
+
 #include <gtest/gtest.h>
 
 #include "tnetstring/all.hpp"
 
 //#define DISABLE_LONGRUN_TESTS
 
+// count of heap allocations, for tests which must not allocate
+static std::atomic<std::size_t> allocation_count(0);
+
+// heap bytes in use, each allocation is preceded by a header holding its size
+static std::atomic<std::size_t> allocated_bytes(0);
+static const std::size_t ALLOCATION_HEADER = alignof(std::max_align_t);
+
+void* operator new(std::size_t size) {
+	allocation_count++;
+	char* p = static_cast<char*>(std::malloc(ALLOCATION_HEADER + size));
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<std::size_t*>(p) = size;
+	allocated_bytes += size;
+	return p + ALLOCATION_HEADER;
+}
+
+void operator delete(void* p) noexcept {
+	if (p != nullptr) {
+		char* block = static_cast<char*>(p) - ALLOCATION_HEADER;
+		allocated_bytes -= *reinterpret_cast<std::size_t*>(block);
+		std::free(block);
+	}
+}
+
 namespace tnetstring {
 
 /**
@@ -34,6 +73,36 @@ protected:
 	virtual void TearDown() {
 		//empty
 	}
+
+	// nested sample document, every level holds some scalars and fanout sub-documents
+	static TNetstring_value nested_list(int depth, int fanout) {
+		TNetstring_list list {"Hello", 123, 1.23, true, nullptr};
+		for (int i = 0; depth > 0 && i < fanout; i++) {
+			list.push_back(nested_list(depth - 1, fanout));
+		}
+		return list;
+	}
+
+	// nested sample document, like nested_list() but made of dicts
+	static TNetstring_value nested_dict(int depth, int fanout) {
+		TNetstring_dict dict {{"key1","Hello"}, {"key2",123}, {"key3",1.23}, {"key4",true}, {"key5",nullptr}};
+		for (int i = 0; depth > 0 && i < fanout; i++) {
+			dict["sub" + std::to_string(i)] = nested_dict(depth - 1, fanout);
+		}
+		return dict;
+	}
+
+	// measures the throughput of f, which processes bytes per call, and prints it
+	template <typename F>
+	static void print_throughput(const std::string& name, std::size_t bytes, int repetitions, F f) {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repetitions; i++) {
+			f();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "[   PERF   ] " << name << ": "
+				<< (bytes * repetitions) / elapsed.count() / 1e6 << " MB/s" << std::endl;
+	}
 };
 
 
@@ -53,10 +122,10 @@ TEST_F(Test_tnetstring_value, Encoder) {
 	os_.str("");
 
 	// put sample data into variant (double), reapply visitor, check
+	// (shortest representation which parses back to the same double)
 	tns_var_ = 12.345;
 	os_ << tns_var_;
-	EXPECT_EQ("18:12.345000",os_.str().substr(0,12)) << "Encoded double netstring is incorrect";
-	EXPECT_EQ("^",os_.str().substr(21,1)) << "Encoded double netstring has wrong type tag";
+	EXPECT_EQ("6:12.345^",os_.str()) << "Encoded double netstring is incorrect";
 	os_.str("");
 
 	// put sample data into variant (float), reapply visitor, check
@@ -110,6 +179,38 @@ TEST_F(Test_tnetstring_value, Encoder) {
 	EXPECT_EQ("56:4:key1,5:Hello,4:key2,3:123#4:key3,4:1.23^4:key4,4:true!}",os_.str()) << "Encoded dictionary netstring is incorrect";
 	os_.str("");
 
+	// const and temporary encoders can be applied as visitors
+	const Encoder encoder(os_);
+	boost::apply_visitor(encoder, tns_var_);
+	boost::apply_visitor(Encoder(os_), tns_var_);
+	EXPECT_EQ(2 * 60, os_.str().size()) << "Encoded dictionary netstrings are incorrect";
+	os_.str("");
+
+	// an encoding interrupted by the stream does not affect the next one
+	struct Limited_buf : std::streambuf {
+		std::string data;
+		std::size_t limit;
+		int_type overflow(int_type c) override {
+			if (data.size() >= limit) {
+				return traits_type::eof();
+			}
+			data.push_back(traits_type::to_char_type(c));
+			return c;
+		}
+	} limited_buf;
+	limited_buf.limit = 10;
+	std::ostream limited_os(&limited_buf);
+	limited_os.exceptions(std::ios::badbit);
+	const Encoder limited_encoder(limited_os);
+	const TNetstring_value nested = TNetstring_list {TNetstring_list {1, 2}, TNetstring_dict {{"key1", "Hello"}}};
+	EXPECT_THROW(boost::apply_visitor(limited_encoder, nested), std::ios_base::failure) << "stream failure not reported";
+	limited_os.clear();
+	limited_buf.data.clear();
+	limited_buf.limit = 1000;
+	boost::apply_visitor(limited_encoder, tns_var_);
+	EXPECT_EQ("56:4:key1,5:Hello,4:key2,3:123#4:key3,4:1.23^4:key4,4:true!}", limited_buf.data)
+			<< "Encoded dictionary netstring is incorrect after a failed encoding";
+
 	} catch (...) {
 		std::cerr << boost::current_exception_diagnostic_information();
 		FAIL();
@@ -147,6 +248,125 @@ TEST_F(Test_tnetstring_value, TNetstring_encoder_longrun) {
 }
 
 
+
+/**
+ * TNetstring_value encoded size calculation, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Encoded_size) {
+	try {
+	const TNetstring_value values[] = {
+		12345, -12345, 0, std::numeric_limits<int>::min(), 12.345, 1.0, true, false, nullptr, "",
+		"HelloDuHelloDuHelloDu", std::string("HelloDuHelloDuHelloDu"),
+		TNetstring_list(), TNetstring_dict(), nested_list(3, 3), nested_dict(3, 3)
+	};
+
+	for (const TNetstring_value& value: values) {
+		os_ << value;
+		EXPECT_EQ(os_.str().size(), encoded_size(value)) << "Encoded size of " << os_.str() << " is incorrect";
+		os_.str("");
+	}
+
+	// size field digits are counted exactly
+	EXPECT_EQ(12, encoded_size(std::string(9, 'a'))) << "Encoded size is incorrect";
+	EXPECT_EQ(14, encoded_size(std::string(10, 'a'))) << "Encoded size is incorrect";
+
+	// payloads are cut after TNETSTRING_DATA_MAXLEN
+	EXPECT_EQ(TNETSTRING_DATA_MAXLEN + 11, Size_calculator::tnetstring_size(TNETSTRING_DATA_MAXLEN + 1)) << "Too long payload is not cut";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TNetstring_value encoding into buffers, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Buffer_encoder) {
+	try {
+	Buffer_encoder encoder;
+
+	EXPECT_EQ("5:12345#", encoder.encode(12345)) << "Encoded integer netstring is incorrect";
+	EXPECT_EQ("11:-2147483648#", encoder.encode(std::numeric_limits<int>::min())) << "Encoded integer netstring is incorrect";
+	EXPECT_EQ("1:0#", encoder.encode(0)) << "Encoded integer netstring is incorrect";
+	EXPECT_EQ("6:12.345^", encoder.encode(12.345)) << "Encoded double netstring is incorrect";
+	EXPECT_EQ("5:false!", encoder.encode(false)) << "Encoded boolean netstring is incorrect";
+	EXPECT_EQ("0:~", encoder.encode(nullptr)) << "Encoded null netstring is incorrect";
+	EXPECT_EQ("0:,", encoder.encode("")) << "Encoded cstring netstring is incorrect";
+	EXPECT_EQ("21:HelloDuHelloDuHelloDu,", encoder.encode(std::string("HelloDuHelloDuHelloDu"))) << "Encoded string netstring is incorrect";
+
+	TNetstring_list list {"Hello", 123, 1.23, true};
+	EXPECT_EQ("28:5:Hello,3:123#4:1.23^4:true!]", encoder.encode(list)) << "Encoded list netstring is incorrect";
+	EXPECT_EQ("0:]", encoder.encode(TNetstring_list())) << "Encoded list netstring is incorrect";
+
+	TNetstring_dict dict {{"key1","Hello"}, {"key2",123}, {"key3",1.23}, {"key4",true}};
+	EXPECT_EQ("56:4:key1,5:Hello,4:key2,3:123#4:key3,4:1.23^4:key4,4:true!}", encoder.encode(dict)) << "Encoded dictionary netstring is incorrect";
+	EXPECT_EQ(encoder.str(), std::string(encoder.data(), encoder.size())) << "Encoded buffer is incorrect";
+
+	// nested documents, identical to the stream encoder
+	tns_var_ = nested_list(3, 3);
+	os_ << tns_var_;
+	EXPECT_EQ(os_.str(), encoder.encode(tns_var_)) << "Encoded nested list netstring is incorrect";
+	os_.str("");
+
+	tns_var_ = nested_dict(3, 3);
+	os_ << tns_var_;
+	EXPECT_EQ(os_.str(), encoder.encode(tns_var_)) << "Encoded nested dict netstring is incorrect";
+	os_.str("");
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TNetstring_value encoding into fixed buffers, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Encode_to) {
+	try {
+	char buffer[1024];
+
+	// mixed document
+	TNetstring_list list {"Hello", 123, -123, 1.23, true, false, nullptr, std::string("HelloDuHelloDuHelloDu")};
+	TNetstring_dict dict {{"key1","Hello"}, {"key2",123}, {"key3",1.23}, {"key4",true}, {"key5",list}};
+	tns_var_ = TNetstring_list {dict, list, 12.345, std::numeric_limits<int>::min()};
+	os_ << tns_var_;
+
+	// no heap allocation at all while encoding
+	std::size_t allocations = allocation_count;
+	std::unique_ptr<int> counted(new int(0));
+	ASSERT_EQ(allocations + 1, allocation_count) << "Allocations are not counted";
+	allocations = allocation_count;
+	Encode_result result = encode_to(buffer, sizeof(buffer), tns_var_);
+	EXPECT_EQ(allocations, allocation_count) << "Encoding allocated memory";
+
+	ASSERT_TRUE(result.ok) << "Encoding failed";
+	EXPECT_EQ(os_.str(), std::string(buffer, result.size)) << "Encoded netstring is incorrect";
+
+	// buffer too small, required size is reported and nothing is written
+	std::memset(buffer, 'x', sizeof(buffer));
+	result = encode_to(buffer, os_.str().size() - 1, tns_var_);
+	EXPECT_FALSE(result.ok) << "Too small buffer not recognized";
+	EXPECT_EQ(os_.str().size(), result.size) << "Required size is incorrect";
+	EXPECT_EQ('x', buffer[0]) << "Too small buffer was written";
+
+	// exact size
+	result = encode_to(buffer, os_.str().size(), tns_var_);
+	EXPECT_TRUE(result.ok) << "Encoding failed";
+	EXPECT_EQ(os_.str(), std::string(buffer, result.size)) << "Encoded netstring is incorrect";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
 /**
  * TNetstring size decoding, using fixture Test_tnetstring_value
  */
@@ -593,33 +813,2818 @@ TEST_F(Test_tnetstring_value, Decoder) {
 
 
 /**
- * TNetstring payload decoding, using fixture Test_tnetstring_value, long running tests
+ * TNetstring size decoding from buffers, using fixture Test_tnetstring_value
  */
-#ifdef DISABLE_LONGRUN_TESTS
-TEST_F(Test_tnetstring_value, DISABLED_Decoder_longrun) {
-#else
-TEST_F(Test_tnetstring_value, Decoder_longrun) {
-#endif
+TEST_F(Test_tnetstring_value, Buffer_decoder_decode_size) {
 	try {
-	std::string remains;
+	std::string input;
 
-	// create maxlen string with 999999999 characters
-	std::string append_str = "abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghi,";
-	std::string str(append_str);
-	for (int i=0;i<tnetstring::TNETSTRING_DATA_MAXLEN/100;i++) {
-		// append 100 characters
-		str.append(append_str);
-	} // 100 * 9999999 + 99 + ","
-	std::string teststr = "999999999:";
-	teststr.append(str);
-	teststr.append("asdf");
-	is_.str(teststr);
-	is_ >> tns_var_;
+	// single character size
+	input = "5:12345#asdf";
+	Buffer_decoder decoder(input);
+	decoder.decode_size();
+	EXPECT_EQ(5, decoder.current_size_) << "parsed size does not match";
+	EXPECT_EQ(2, decoder.position()) << "size field not consumed";
+
+	// maximum length size
+	input = "123456789:12345#asdf";
+	decoder = Buffer_decoder(input);
+	decoder.decode_size();
+	EXPECT_EQ(123456789, decoder.current_size_) << "parsed size does not match";
+	EXPECT_EQ(9, decoder.current_size_digits_) << "parsed size digits do not match";
+
+	// zero size
+	input = "0:~";
+	decoder = Buffer_decoder(input);
+	decoder.decode_size();
+	EXPECT_EQ(0, decoder.current_size_) << "parsed size does not match";
+
+	// maximum+1 length size
+	input = "1234567890:12345#asdf";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode_size(), Parse_exception) << "invalid netstring not recognized";
+
+	// premature end of tnetstring
+	input = "1";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode_size(), Parse_exception) << "invalid netstring not recognized";
+
+	// no int
+	input = "a:12345#asdf";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode_size(), Parse_exception) << "invalid netstring not recognized";
+
+	// empty size field
+	input = ":12345#asdf";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode_size(), Parse_exception) << "invalid netstring not recognized";
+
+	// empty netstring
+	input = "";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode_size(), Parse_exception) << "invalid netstring not recognized";
+
+	// same position info as the stream decoder
+	input = "12a:";
+	decoder = Buffer_decoder(input);
+	try {
+		decoder.decode_size();
+		FAIL() << "invalid netstring not recognized";
+	} catch (Parse_exception& e) {
+		ASSERT_NE(nullptr, boost::get_error_info<Parse_pos_info>(e));
+		EXPECT_EQ(2, *boost::get_error_info<Parse_pos_info>(e)) << "wrong parse position";
+		EXPECT_EQ('a', *boost::get_error_info<Parse_char_info>(e)) << "wrong parse character";
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TNetstring_value decoding from buffers, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Buffer_decoder) {
+	try {
+	std::string input;
+
+	// scalars back to back, cursor advances by the consumed bytes
+	input = "5:12345#7:12.3450^26:abcdefghijklmnopqrstuvwxyz,4:true!5:false!0:~0:,asdf";
+	Buffer_decoder decoder(input);
+
+	EXPECT_EQ(8, decoder.decode(tns_var_)) << "wrong count of consumed bytes";
+	ASSERT_EQ(typeid(int), tns_var_.type()) << "Decoded netstring value is not an integer";
+	EXPECT_EQ(12345, boost::get<int>(tns_var_)) << "decoded payload does not match";
+
+	EXPECT_EQ(10, decoder.decode(tns_var_)) << "wrong count of consumed bytes";
+	ASSERT_EQ(typeid(double), tns_var_.type()) << "Decoded netstring value is not a double";
+	EXPECT_EQ(12.345, boost::get<double>(tns_var_)) << "decoded payload does not match";
+
+	decoder.decode(tns_var_);
 	ASSERT_EQ(typeid(std::string), tns_var_.type()) << "Decoded netstring value is not a string";
-	EXPECT_EQ(999999999, boost::get<std::string>(tns_var_).size()) << "decoded payload has wrong size";
-	is_ >> remains;
-	EXPECT_EQ("asdf", remains) << "Stream remainings are wrong";
-	is_.clear(); // ... we read until eos
+	EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", boost::get<std::string>(tns_var_)) << "decoded payload does not match";
+
+	decoder.decode(tns_var_);
+	ASSERT_EQ(typeid(bool), tns_var_.type()) << "Decoded netstring value is not a bool";
+	EXPECT_EQ(true, boost::get<bool>(tns_var_)) << "decoded payload does not match";
+
+	decoder.decode(tns_var_);
+	ASSERT_EQ(typeid(bool), tns_var_.type()) << "Decoded netstring value is not a bool";
+	EXPECT_EQ(false, boost::get<bool>(tns_var_)) << "decoded payload does not match";
+
+	decoder.decode(tns_var_);
+	ASSERT_EQ(typeid(const char*), tns_var_.type()) << "Decoded netstring value is not a blank";
+
+	decoder.decode(tns_var_);
+	ASSERT_EQ(typeid(std::string), tns_var_.type()) << "Decoded netstring value is not a string";
+	EXPECT_EQ("", boost::get<std::string>(tns_var_)) << "decoded payload does not match";
+
+	EXPECT_EQ(4, decoder.remaining()) << "Buffer remainings are wrong";
+	EXPECT_EQ(input.size() - 4, decoder.position()) << "Buffer position is wrong";
+
+	// strings containing whitespace
+	input = "11:Hello World,";
+	decoder = Buffer_decoder(input);
+	decoder.decode(tns_var_);
+	EXPECT_EQ("Hello World", boost::get<std::string>(tns_var_)) << "decoded payload does not match";
+
+	// list (nested), compared to the stream decoder
+	input = "94:6:Hello3,3:123#4:1.23^4:true!61:6:Hello2,3:123#4:1.23^4:true!28:5:Hello,3:123#4:1.23^4:true!]]]asdf";
+	decoder = Buffer_decoder(input);
+	EXPECT_EQ(input.size() - 4, decoder.decode(tns_var_)) << "wrong count of consumed bytes";
+	std::ostringstream result;
+	result << tns_var_;
+	EXPECT_EQ(input.substr(0, input.size() - 4), result.str()) << "decoded payload does not match";
+
+	// dict (nested)
+	input = "123:4:key5,5:Hello,4:key6,3:123#4:key7,4:1.23^4:key8,4:true!4:key9,56:4:key1,5:Hello,4:key2,3:123#4:key3,4:1.23^4:key4,4:true!}}";
+	decoder = Buffer_decoder(input);
+	EXPECT_EQ(input.size(), decoder.decode(tns_var_)) << "wrong count of consumed bytes";
+	result.str("");
+	result << tns_var_;
+	EXPECT_EQ(input, result.str()) << "decoded payload does not match";
+
+	// empty containers
+	input = "0:]0:}";
+	decoder = Buffer_decoder(input);
+	decoder.decode(tns_var_);
+	EXPECT_TRUE(boost::get<TNetstring_list>(tns_var_).empty()) << "decoded payload does not match";
+	decoder.decode(tns_var_);
+	EXPECT_TRUE(boost::get<TNetstring_dict>(tns_var_).empty()) << "decoded payload does not match";
+
+	// premature end
+	input = "3:ab";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "invalid netstring not recognized";
+
+	// unsupported type
+	input = "5:12345?asdf";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "invalid netstring not recognized";
+
+	// element exceeding its container
+	input = "5:4:ab]]";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "invalid netstring not recognized";
+
+	// non-string dict key
+	input = "16:1:1#5:Hello,}";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "invalid netstring not recognized";
+
+	// invalid integer
+	input = "3:1a2#";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "invalid netstring not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TNetstring views, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, View) {
+	try {
+	std::string input;
+
+	// scalars
+	input = "5:12345#asdf";
+	View view(input);
+	EXPECT_EQ('#', view.type()) << "viewed type does not match";
+	EXPECT_EQ(12345, view.as_int()) << "viewed payload does not match";
+	EXPECT_EQ(8, view.size()) << "viewed size does not match";
+	EXPECT_EQ(input.data(), view.data()) << "view does not point into the buffer";
+	EXPECT_THROW(view.as_string_view(), Type_exception) << "wrong type not recognized";
+
+	input = "7:12.3450^";
+	EXPECT_EQ(12.345, View(input).as_double()) << "viewed payload does not match";
+
+	input = "11:Hello World,";
+	EXPECT_EQ("Hello World", View(input).as_string_view()) << "viewed payload does not match";
+	EXPECT_EQ(input.data() + 3, View(input).as_string_view().data()) << "viewed payload is a copy";
+
+	input = "4:true!";
+	EXPECT_TRUE(View(input).as_bool()) << "viewed payload does not match";
+
+	input = "0:~";
+	EXPECT_TRUE(View(input).is_null()) << "viewed payload does not match";
+
+	// list iteration
+	input = "28:5:Hello,3:123#4:1.23^4:true!]";
+	view = View(input);
+	std::vector<char> types;
+	for (const View& element : view) {
+		types.push_back(element.type());
+	}
+	EXPECT_EQ(std::vector<char>({',', '#', '^', '!'}), types) << "viewed list elements do not match";
+	EXPECT_EQ(123, (++view.begin())->as_int()) << "viewed list element does not match";
+
+	input = "0:]";
+	view = View(input);
+	EXPECT_TRUE(view.begin() == view.end()) << "empty list is not empty";
+
+	// dict lookup (nested)
+	input = "123:4:key5,5:Hello,4:key6,3:123#4:key7,4:1.23^4:key8,4:true!4:key9,56:4:key1,5:Hello,4:key2,3:123#4:key3,4:1.23^4:key4,4:true!}}";
+	view = View(input);
+	EXPECT_EQ(123, view.find("key6").as_int()) << "viewed dict value does not match";
+	EXPECT_EQ("Hello", view.find("key9").find("key1").as_string_view()) << "viewed dict value does not match";
+	EXPECT_FALSE(view.find("key1")) << "missing key found";
+	EXPECT_THROW(view.find("key6").find("key1"), Type_exception) << "wrong type not recognized";
+	view.validate();
+
+	// lazy validation, only touched values are parsed
+	input = "22:4:key1,1:1#4:key2,1:x#}";
+	view = View(input);
+	EXPECT_EQ(1, view.find("key1").as_int()) << "viewed dict value does not match";
+	EXPECT_THROW(view.find("key2").as_int(), Parse_exception) << "invalid payload not recognized";
+	EXPECT_THROW(view.validate(), Parse_exception) << "invalid payload not recognized";
+
+	input = "17:1:1#4:true!3:abc!]";
+	EXPECT_THROW(View(input).validate(), Parse_exception) << "invalid boolean not recognized";
+
+	input = "8:1:1#1:2#}";
+	EXPECT_THROW(View(input).validate(), Parse_exception) << "non-string key not recognized";
+
+	// nesting deeper than the limit fails instead of exhausting the stack
+	std::string deep = "0:]";
+	for (std::size_t level = 1; level <= VALIDATE_DEPTH_MAX; level++) {
+		deep = std::to_string(deep.size()) + ":" + deep + "]";
+	}
+	EXPECT_THROW(View(deep).validate(), Parse_exception) << "too deep nesting not recognized";
+	View(deep).begin()->validate();
+	input = "6:3:0:}]]";
+	View(input).validate(3);
+	EXPECT_THROW(View(input).validate(2), Parse_exception) << "nesting beyond the limit not recognized";
+
+	// invalid headers
+	input = "3:ab";
+	EXPECT_THROW(View(input.data(), input.size()), Parse_exception) << "invalid netstring not recognized";
+	input = "5:12345?";
+	EXPECT_THROW(View(input.data(), input.size()), Parse_exception) << "invalid netstring not recognized";
+	input = "5:4:ab]]";
+	EXPECT_THROW(View(input).begin(), Parse_exception) << "invalid netstring not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Number formatting and parsing kernels, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Numbers) {
+	char buf[DOUBLE_FORMAT_MAXLEN];
+	int int_val = 0;
+	double double_val = 0;
+	std::size_t size = 0;
+
+	// integer formatting
+	EXPECT_EQ("0", std::string(buf, format_int(0, buf)));
+	EXPECT_EQ("7", std::string(buf, format_int(7, buf)));
+	EXPECT_EQ("10", std::string(buf, format_int(10, buf)));
+	EXPECT_EQ("-12345", std::string(buf, format_int(-12345, buf)));
+	EXPECT_EQ("2147483647", std::string(buf, format_int(std::numeric_limits<int>::max(), buf)));
+	EXPECT_EQ("-2147483648", std::string(buf, format_int(std::numeric_limits<int>::min(), buf)));
+	EXPECT_EQ("18446744073709551615", std::string(buf, format_uint64(std::numeric_limits<std::uint64_t>::max(), buf)));
+
+	// integer parsing, overflow checked
+	EXPECT_TRUE(parse_int("12345", 5, int_val)); EXPECT_EQ(12345, int_val);
+	EXPECT_TRUE(parse_int("-12345", 6, int_val)); EXPECT_EQ(-12345, int_val);
+	EXPECT_TRUE(parse_int("+1", 2, int_val)); EXPECT_EQ(1, int_val);
+	EXPECT_TRUE(parse_int("2147483647", 10, int_val)); EXPECT_EQ(std::numeric_limits<int>::max(), int_val);
+	EXPECT_TRUE(parse_int("-2147483648", 11, int_val)); EXPECT_EQ(std::numeric_limits<int>::min(), int_val);
+	EXPECT_FALSE(parse_int("2147483648", 10, int_val));
+	EXPECT_FALSE(parse_int("-2147483649", 11, int_val));
+	EXPECT_FALSE(parse_int("", 0, int_val));
+	EXPECT_FALSE(parse_int("-", 1, int_val));
+	EXPECT_FALSE(parse_int("1a2", 3, int_val));
+	EXPECT_FALSE(parse_int(" 12", 3, int_val));
+
+	// double formatting, shortest round trip
+	EXPECT_EQ("12.345", std::string(buf, format_double(12.345, buf)));
+	EXPECT_EQ("0.1", std::string(buf, format_double(0.1, buf)));
+	EXPECT_EQ("0", std::string(buf, format_double(0.0, buf)));
+	EXPECT_EQ("-1.5", std::string(buf, format_double(-1.5, buf)));
+
+	// double parsing, the range is not terminated
+	EXPECT_TRUE(parse_double("12.345^", 6, double_val)); EXPECT_EQ(12.345, double_val);
+	EXPECT_TRUE(parse_double("1e10", 4, double_val)); EXPECT_EQ(1e10, double_val);
+	EXPECT_FALSE(parse_double("", 0, double_val));
+	EXPECT_FALSE(parse_double(" 1", 2, double_val));
+	EXPECT_FALSE(parse_double("1.2.3", 5, double_val));
+	const std::string long_double_str = "1." + std::string(100, '0');
+	EXPECT_TRUE(parse_double(long_double_str.data(), long_double_str.size(), double_val)); EXPECT_EQ(1.0, double_val);
+
+	// doubles are formatted and parsed with '.' whatever the LC_NUMERIC locale, if one with ',' is installed
+	const std::string numeric_locale = std::setlocale(LC_NUMERIC, nullptr);
+	const char* comma_locales[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR"};
+	for (const char* comma_locale: comma_locales) {
+		if (std::setlocale(LC_NUMERIC, comma_locale) != nullptr) {
+			EXPECT_EQ("12.345", std::string(buf, format_double(12.345, buf))) << "formatted with the decimal point of " << comma_locale;
+			EXPECT_EQ("-1.5", std::string(buf, format_double(-1.5, buf))) << "formatted with the decimal point of " << comma_locale;
+			EXPECT_TRUE(parse_double("12.345", 6, double_val)); EXPECT_EQ(12.345, double_val);
+			EXPECT_TRUE(parse_double(long_double_str.data(), long_double_str.size(), double_val)); EXPECT_EQ(1.0, double_val);
+			EXPECT_FALSE(parse_double("12,345", 6, double_val)) << "decimal point of " << comma_locale << " accepted";
+			break;
+		}
+	}
+	std::setlocale(LC_NUMERIC, numeric_locale.c_str());
+
+	// size fields, short and long buffers take different paths
+	const std::string size_fields[] = {"5:", "5:12345#", "12345678:", "123456789:abcdefgh", "1234567:abcdefgh", "0:~"};
+	const std::size_t sizes[] = {5, 5, 12345678, 123456789, 1234567, 0};
+	for (int i = 0; i < 6; i++) {
+		const std::string& field = size_fields[i];
+		EXPECT_EQ(field.find(':'), parse_size(field.data(), field.data() + field.size(), size)) << field;
+		EXPECT_EQ(sizes[i], size) << field;
+	}
+
+	// malformed size fields are left to the caller
+	const std::string bad_fields[] = {"", ":", "1234567890:", "12a:", "12", "12345678", "123456789", "1234a678:", "a2345678:"};
+	for (const std::string& field : bad_fields) {
+		EXPECT_EQ(0, parse_size(field.data(), field.data() + field.size(), size)) << field;
+	}
+}
+
+
+
+/**
+ * Random ints and doubles round trip through encoders and decoders, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Numbers_roundtrip) {
+	try {
+	std::mt19937_64 random(42);
+	std::uniform_int_distribution<int> ints(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+	std::uniform_real_distribution<double> doubles(-1e6, 1e6);
+	Buffer_encoder encoder;
+
+	for (int i = 0; i < 10000; i++) {
+		// random ints and doubles, including doubles from random bit patterns
+		double double_val = doubles(random);
+		if (i % 2) {
+			const std::uint64_t bits = random();
+			std::memcpy(&double_val, &bits, sizeof(double_val));
+			if (!std::isfinite(double_val)) {
+				continue;
+			}
+		}
+
+		const TNetstring_value values[] = {ints(random), double_val};
+		for (const TNetstring_value& value : values) {
+			const boost::string_view encoded = encoder.encode(value);
+
+			Buffer_decoder decoder(encoded.data(), encoded.size());
+			decoder.decode(tns_var_);
+			ASSERT_TRUE(value == tns_var_) << "Roundtrip failed for " << encoded;
+
+			is_.clear();
+			is_.str(std::string(encoded.data(), encoded.size()));
+			is_ >> tns_var_;
+			ASSERT_TRUE(value == tns_var_) << "Roundtrip failed for " << encoded;
+		}
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * 64 bit integer encoding and decoding, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Int64) {
+	try {
+	Buffer_encoder encoder;
+	std::string input;
+
+	// encoding
+	tns_var_ = std::int64_t(1234567890123LL);
+	os_ << tns_var_;
+	EXPECT_EQ("13:1234567890123#", os_.str()) << "Encoded int64 netstring is incorrect";
+	os_.str("");
+
+	tns_var_ = std::numeric_limits<std::int64_t>::min();
+	os_ << tns_var_;
+	EXPECT_EQ("20:-9223372036854775808#", os_.str()) << "Encoded int64 netstring is incorrect";
+	EXPECT_EQ(os_.str(), encoder.encode(tns_var_)) << "Encoded int64 netstring is incorrect";
+	EXPECT_EQ(os_.str().size(), encoded_size(tns_var_)) << "Encoded size is incorrect";
+	os_.str("");
+
+	tns_var_ = std::numeric_limits<std::uint64_t>::max();
+	os_ << tns_var_;
+	EXPECT_EQ("20:18446744073709551615#", os_.str()) << "Encoded uint64 netstring is incorrect";
+	EXPECT_EQ(os_.str(), encoder.encode(tns_var_)) << "Encoded uint64 netstring is incorrect";
+	EXPECT_EQ(os_.str().size(), encoded_size(tns_var_)) << "Encoded size is incorrect";
+	os_.str("");
+
+	// decoding to the narrowest type
+	input = "10:2147483647#10:2147483648#11:-2147483648#11:-2147483649#20:-9223372036854775808#19:9223372036854775808#20:18446744073709551615#";
+	Buffer_decoder decoder(input);
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(int), tns_var_.type()) << "Decoded integer has the wrong type";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(std::int64_t), tns_var_.type()) << "Decoded integer has the wrong type";
+	EXPECT_EQ(2147483648LL, boost::get<std::int64_t>(tns_var_)) << "decoded payload does not match";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(int), tns_var_.type()) << "Decoded integer has the wrong type";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(std::int64_t), tns_var_.type()) << "Decoded integer has the wrong type";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(std::numeric_limits<std::int64_t>::min(), boost::get<std::int64_t>(tns_var_)) << "decoded payload does not match";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(std::uint64_t), tns_var_.type()) << "Decoded integer has the wrong type";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(std::numeric_limits<std::uint64_t>::max(), boost::get<std::uint64_t>(tns_var_)) << "decoded payload does not match";
+
+	// stream decoder
+	is_.str("13:1234567890123#");
+	is_ >> tns_var_;
+	EXPECT_EQ(1234567890123LL, boost::get<std::int64_t>(tns_var_)) << "decoded payload does not match";
+
+	// decoding to the configured type
+	input = "5:12345#";
+	decoder = Buffer_decoder(input, INT_64);
+	decoder.decode(tns_var_);
+	EXPECT_EQ(typeid(std::int64_t), tns_var_.type()) << "Decoded integer has the wrong type";
+	EXPECT_EQ(12345, boost::get<std::int64_t>(tns_var_)) << "decoded payload does not match";
+
+	// out of range
+	input = "20:18446744073709551616#";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "out of range integer not recognized";
+	input = "20:-9223372036854775809#";
+	decoder = Buffer_decoder(input);
+	EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "out of range integer not recognized";
+
+	// views
+	input = "20:-9223372036854775808#";
+	EXPECT_EQ(std::numeric_limits<std::int64_t>::min(), View(input).as_int64()) << "viewed payload does not match";
+	EXPECT_THROW(View(input).as_uint64(), Parse_exception) << "negative unsigned integer not recognized";
+	EXPECT_THROW(View(input).as_int(), Parse_exception) << "out of range integer not recognized";
+	View(input).validate();
+	input = "20:18446744073709551615#";
+	EXPECT_EQ(std::numeric_limits<std::uint64_t>::max(), View(input).as_uint64()) << "viewed payload does not match";
+
+	// random round trips
+	std::mt19937_64 random(42);
+	for (int i = 0; i < 10000; i++) {
+		const std::uint64_t bits = random();
+		const TNetstring_value values[] = {static_cast<std::int64_t>(bits), bits};
+		for (const TNetstring_value& value : values) {
+			const boost::string_view encoded = encoder.encode(value);
+			decoder = Buffer_decoder(encoded.data(), encoded.size(), INT_64);
+			const std::string expected(encoded.data(), encoded.size());
+			decoder.decode(tns_var_);
+			EXPECT_EQ(expected, encoder.encode(tns_var_)) << "Roundtrip failed for " << expected;
+		}
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Decoding of nested documents, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Decoder_nested) {
+	try {
+	const TNetstring_value documents[] = {nested_list(4, 3), nested_dict(4, 3)};
+
+	for (const TNetstring_value& document : documents) {
+		os_.str("");
+		os_ << document;
+		const std::string encoded = os_.str();
+
+		// stream decoder
+		is_.str(encoded);
+		is_ >> tns_var_;
+		os_.str("");
+		os_ << tns_var_;
+		EXPECT_EQ(encoded, os_.str()) << "stream decoded document does not match";
+
+		// buffer decoder, decoding into a value already holding a document
+		Buffer_decoder decoder(encoded);
+		decoder.decode(tns_var_);
+		os_.str("");
+		os_ << tns_var_;
+		EXPECT_EQ(encoded, os_.str()) << "buffer decoded document does not match";
+	}
+
+	// duplicate keys keep the first value
+	std::string input = "28:3:key,1:1#3:key,1:2#1:x,1:3#}";
+	is_.str(input);
+	is_ >> tns_var_;
+	EXPECT_EQ(2, boost::get<TNetstring_dict>(tns_var_).size()) << "decoded dict has wrong size";
+	EXPECT_EQ(1, boost::get<int>(boost::get<TNetstring_dict>(tns_var_)["key"])) << "decoded payload does not match";
+
+	Buffer_decoder decoder(input);
+	decoder.decode(tns_var_);
+	EXPECT_EQ(2, boost::get<TNetstring_dict>(tns_var_).size()) << "decoded dict has wrong size";
+	EXPECT_EQ(1, boost::get<int>(boost::get<TNetstring_dict>(tns_var_)["key"])) << "decoded payload does not match";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Stream encoder heap allocations, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Encoder_allocations) {
+	try {
+	const TNetstring_value documents[] = {nested_list(5, 3), nested_dict(5, 3)};
+
+	for (const TNetstring_value& document : documents) {
+		os_.str("");
+		os_ << document;
+		const std::string encoded = os_.str();
+
+		// encode again over the already grown stream buffer
+		os_.seekp(0);
+		const std::size_t allocations = allocation_count;
+		os_ << document;
+		const std::size_t encoding_allocations = allocation_count - allocations;
+		EXPECT_EQ(encoded, os_.str()) << "Encoded netstring is incorrect";
+
+		// only the container size table of the encoder may allocate, the
+		// 364 nested containers must neither be copied nor buffered
+		EXPECT_GE(16u, encoding_allocations) << "Encoding allocated per element";
+	}
+	os_.str("");
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Arena allocated decoding, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Arena_decoder) {
+	try {
+	Arena arena(256);
+	const std::string input = "60:4:key1,5:Hello,4:key2,3:123#4:key3,11:1:a,4:true!]4:key4,0:~}";
+
+	Arena_value value;
+	Arena_decoder decoder(input, INT_NARROWEST, arena);
+	EXPECT_EQ(input.size(), decoder.decode(value)) << "decoded size does not match";
+
+	ASSERT_EQ(typeid(Arena_dict), value.type()) << "Decoded netstring value is not a dict";
+	Arena_dict& dict = boost::get<Arena_dict>(value);
+	EXPECT_EQ(4, dict.size()) << "decoded dict has wrong size";
+	EXPECT_EQ("Hello", boost::get<Arena_string>(dict.at(Arena_string("key1", arena))));
+	EXPECT_EQ(123, boost::get<int>(dict.at(Arena_string("key2", arena))));
+	const Arena_list& list = boost::get<Arena_list>(dict.at(Arena_string("key3", arena)));
+	ASSERT_EQ(2, list.size()) << "decoded list has wrong size";
+	EXPECT_EQ("a", boost::get<Arena_string>(list[0]));
+	EXPECT_TRUE(boost::get<bool>(list[1]));
+	EXPECT_EQ(nullptr, boost::get<const char*>(dict.at(Arena_string("key4", arena))));
+
+	// all the decoded values live in the arena
+	EXPECT_EQ(&arena, dict.get_allocator().arena()) << "dict is not allocated from the arena";
+	EXPECT_EQ(&arena, list.get_allocator().arena()) << "list is not allocated from the arena";
+
+	// decoding into a released arena reuses its largest block
+	value = nullptr;
+	arena.release();
+	const std::size_t capacity = arena.capacity();
+	const std::size_t allocations = allocation_count;
+	decoder = Arena_decoder(input, INT_NARROWEST, arena);
+	decoder.decode(value);
+	EXPECT_EQ(allocations, allocation_count) << "Decoding into a released arena allocated memory";
+	EXPECT_EQ(capacity, arena.capacity()) << "Arena has grown";
+
+	// errors are reported like with the heap allocating decoder
+	const std::string list_input = "8:1:a,1:b,]";
+	decoder = Arena_decoder(list_input, INT_NARROWEST, arena);
+	decoder.decode(value);
+	ASSERT_EQ(typeid(Arena_list), value.type()) << "Decoded netstring value is not a list";
+	EXPECT_EQ(2, boost::get<Arena_list>(value).size()) << "decoded list has wrong size";
+	const std::string non_string_key = "8:1:1#1:b,}";
+	decoder = Arena_decoder(non_string_key, INT_NARROWEST, arena);
+	EXPECT_THROW(decoder.decode(value), Parse_exception) << "non string key not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Incremental decoding of pieces of data, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Push_parser) {
+	try {
+	Push_parser parser;
+	os_ << TNetstring_value(nested_dict(2, 2)) << TNetstring_value("Hello") << TNetstring_value(12345)
+			<< TNetstring_value(nested_list(3, 2)) << TNetstring_value(nullptr);
+	const std::string input = os_.str();
+	os_.str("");
+
+	// empty parser
+	EXPECT_FALSE(parser.next(tns_var_)) << "value fetched from empty parser";
+	EXPECT_EQ(3, parser.needed()) << "needed byte count is incorrect";
+
+	// size field split up
+	EXPECT_EQ(2, parser.feed("1", 1)) << "needed byte count is incorrect";
+	EXPECT_EQ(2, parser.feed("2", 1)) << "needed byte count is incorrect";
+	EXPECT_EQ(13, parser.feed(":", 1)) << "needed byte count is incorrect";
+	EXPECT_EQ(0, parser.available()) << "incomplete value is available";
+	EXPECT_EQ(4, parser.feed("1:a,2:bc,")) << "needed byte count is incorrect";
+	EXPECT_EQ(1, parser.feed("0:~")) << "needed byte count is incorrect";
+	EXPECT_EQ(3, parser.feed("]")) << "needed byte count is incorrect";
+	ASSERT_EQ(1, parser.available()) << "completed value is not available";
+	ASSERT_TRUE(parser.next(tns_var_)) << "completed value cannot be fetched";
+	EXPECT_EQ(3, boost::get<TNetstring_list>(tns_var_).size()) << "decoded list has wrong size";
+	EXPECT_FALSE(parser.next(tns_var_)) << "value fetched twice";
+
+	// all the values fed at once, in pieces of growing size and byte by byte
+	for (std::size_t piece = input.size(); piece > 0; piece = piece / 3) {
+		std::ostringstream os;
+		for (std::size_t i = 0; i < input.size(); i += piece) {
+			const std::size_t needed = parser.feed(input.substr(i, piece));
+			const std::size_t fed = std::min(input.size(), i + piece);
+			if (fed < input.size()) {
+				EXPECT_GE(input.size() - fed, needed) << "needed byte count exceeds the remaining bytes";
+			}
+			while (parser.next(tns_var_)) {
+				os << tns_var_;
+			}
+		}
+		EXPECT_EQ(input, os.str()) << "values decoded from pieces of " << piece << " bytes do not match";
+		EXPECT_EQ(3, parser.needed()) << "needed byte count is incorrect";
+	}
+
+	// errors are thrown as soon as they are fed
+	EXPECT_THROW(parser.feed("12a"), Parse_exception) << "non numeric size not recognized";
+	parser.reset();
+	EXPECT_THROW(parser.feed(":"), Parse_exception) << "empty size not recognized";
+	parser.reset();
+	EXPECT_THROW(parser.feed("1234567890"), Parse_exception) << "too large size not recognized";
+	parser.reset();
+	parser.feed("3:1:a");
+	EXPECT_THROW(parser.feed(",x"), Parse_exception) << "illegal type not recognized";
+	parser.reset();
+	EXPECT_THROW(parser.feed("3:abc#5:hello,"), Parse_exception) << "illegal integer not recognized";
+	EXPECT_EQ(0, parser.available()) << "failed value is available";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Parser handler recording the events as text
+ */
+struct Event_recorder {
+	std::ostringstream events;
+
+	void on_null() { events << "null "; }
+	void on_bool(bool value) { events << (value ? "true " : "false "); }
+	void on_int(std::int64_t value) { events << "int(" << value << ") "; }
+	void on_uint(std::uint64_t value) { events << "uint(" << value << ") "; }
+	void on_double(double value) { events << "double(" << value << ") "; }
+	void on_string(boost::string_view value) { events << "string(" << value << ") "; }
+	void begin_list() { events << "[ "; }
+	void end_list() { events << "] "; }
+	void begin_dict() { events << "{ "; }
+	void key(boost::string_view key) { events << key << ": "; }
+	void end_dict() { events << "} "; }
+};
+
+/**
+ * Parser handler counting the values and string bytes
+ */
+struct Value_counter {
+	std::size_t values = 0;
+	std::size_t string_bytes = 0;
+
+	void on_null() { values++; }
+	void on_bool(bool) { values++; }
+	void on_int(std::int64_t) { values++; }
+	void on_uint(std::uint64_t) { values++; }
+	void on_double(double) { values++; }
+	void on_string(boost::string_view value) { values++; string_bytes += value.size(); }
+	void begin_list() { values++; }
+	void end_list() {}
+	void begin_dict() { values++; }
+	void key(boost::string_view key) { string_bytes += key.size(); }
+	void end_dict() {}
+};
+
+/**
+ * Event parsing, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Parser) {
+	try {
+	Event_recorder recorder;
+	std::string input = "95:4:key1,5:Hello,4:key2,3:-12#4:key3,20:18446744073709551615#4:key4,25:4:1.25^4:true!5:false!0:~]}asdf";
+
+	Parser<Event_recorder> parser(input.data(), input.size(), recorder);
+	EXPECT_EQ(input.size() - 4, parser.parse()) << "parsed size does not match";
+	EXPECT_EQ(4, parser.remaining()) << "remaining size does not match";
+	EXPECT_EQ("{ key1: string(Hello) key2: int(-12) key3: uint(18446744073709551615) "
+	          "key4: [ double(1.25) true false null ] } ", recorder.events.str()) << "parsed events do not match";
+
+	// the events of a nested document
+	os_ << TNetstring_value(nested_dict(3, 2));
+	Value_counter counter;
+	EXPECT_EQ(os_.str().size(), parse(os_.str().data(), os_.str().size(), counter)) << "parsed size does not match";
+	EXPECT_EQ(15 * 6, counter.values) << "count of parsed values does not match";
+	os_.str("");
+
+	// errors
+	input = "8:1:1#1:b,}";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "non string key not recognized";
+	input = "5:4:ab]]";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "element exceeding its container not recognized";
+	input = "5:1:a,";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "premature end not recognized";
+	input = "3:abc#";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "illegal integer not recognized";
+	input = "3:abcX";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "illegal type not recognized";
+	input = "a:";
+	EXPECT_THROW(parse(input.data(), input.size(), recorder), Parse_exception) << "illegal size not recognized";
+
+	// errors are diagnosed like by Buffer_decoder, also for size fields cut by their container
+	const std::string malformed[] = {"4:0:~1]", "5:0:~1:]", "4:1:a}", "8:3:key}", "9:1:a,12:}", "5:4:ab]]", "5:1:a,"};
+	for (const std::string& i: malformed) {
+		std::string parser_error;
+		std::string decoder_error;
+		try {
+			parse(i.data(), i.size(), recorder);
+		} catch (Parse_exception& e) {
+			parser_error = *boost::get_error_info<Error_msg_info>(e);
+		}
+		try {
+			Buffer_decoder(i).decode(tns_var_);
+		} catch (Parse_exception& e) {
+			decoder_error = *boost::get_error_info<Error_msg_info>(e);
+		}
+		EXPECT_FALSE(parser_error.empty()) << i << " not recognized";
+		EXPECT_EQ(decoder_error, parser_error) << "diagnosis of " << i << " differs";
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Validation of untrusted TNetstrings, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Validate) {
+	try {
+	Validate_result result;
+
+	// valid documents, validated without allocating
+	const TNetstring_value documents[] = {nested_list(3, 2), nested_dict(3, 2), std::numeric_limits<std::uint64_t>::max(),
+			std::numeric_limits<std::int64_t>::min(), -1.5e-300, std::string(100, '7'), nullptr};
+	for (const TNetstring_value& document : documents) {
+		os_.str("");
+		os_ << document << "asdf";
+		const std::string input = os_.str();
+		const std::size_t allocations = allocation_count;
+		result = validate(input.data(), input.size());
+		EXPECT_EQ(allocations, allocation_count) << "Validation allocated memory";
+		EXPECT_TRUE(result.ok) << "valid TNetstring not recognized: " << input;
+		EXPECT_EQ(input.size() - 4, result.position) << "validated size does not match";
+		EXPECT_EQ(nullptr, result.error) << "error reported for valid TNetstring";
+	}
+	os_.str("");
+
+	// numbers accepted like the decoders do
+	const std::string valid[] = {"2:+1#", "1:0#", "22:-000000000000000000001#", "2:1.^", "2:.5^", "6:1.5E+3^",
+			"3:inf^", "3:nan^", "6:0x1p-2^", "4:true!", "5:false!", "5:hello,"};
+	for (const std::string& input : valid) {
+		EXPECT_TRUE(validate(input.data(), input.size()).ok) << "valid TNetstring not recognized: " << input;
+	}
+
+	// the first error with its position
+	struct Invalid {
+		std::string input;
+		std::size_t position;
+		std::string error;
+	};
+	const Invalid invalid[] = {
+		{"", 0, "Premature end of TNetstring"},
+		{"12", 2, "Premature end of TNetstring"},
+		{":~", 0, "TNetstring size field is not an integer."},
+		{"1a:~", 1, "TNetstring size field is not a digit"},
+		{"1234567890:", 9, "TNetstring size field is too large"},
+		{"5:abc,", 0, "Premature end of TNetstring"},
+		{"3:abcX", 5, "Illegal or unsupported TNetstring payload type"},
+		{"2:1a#", 2, "TNetstring payload cannot be casted to int"},
+		{"1:-#", 2, "TNetstring payload cannot be casted to int"},
+		{"20:18446744073709551616#", 3, "TNetstring payload cannot be casted to int"},
+		{"20:-9223372036854775809#", 3, "TNetstring payload cannot be casted to int"},
+		{"3:1e+^", 2, "TNetstring payload cannot be casted to double"},
+		{"2: 1^", 2, "TNetstring payload cannot be casted to double"},
+		{"4:True!", 2, "TNetstring payload is no boolean"},
+		{"5:4:ab]]", 2, "TNetstring element exceeds its container"},
+		{"8:1:1#1:b,}", 5, "dict key must be of type string"},
+		{"4:1:a,}", 6, "Premature end of TNetstring"},
+		{"12:9:1:a,2:1x#]]", 11, "TNetstring payload cannot be casted to int"},
+	};
+	for (const Invalid& i : invalid) {
+		result = validate(i.input.data(), i.input.size());
+		EXPECT_FALSE(result.ok) << "invalid TNetstring not recognized: " << i.input;
+		EXPECT_EQ(i.position, result.position) << "error position does not match: " << i.input;
+		ASSERT_NE(nullptr, result.error) << "error not reported: " << i.input;
+		EXPECT_EQ(i.error, result.error) << "error does not match: " << i.input;
+
+		// the decoders refuse them as well
+		if (i.error != "TNetstring payload is no boolean") {
+			Buffer_decoder decoder(i.input);
+			EXPECT_THROW(decoder.decode(tns_var_), Parse_exception) << "decoder accepts " << i.input;
+		}
+	}
+
+	// nesting deeper than the limit fails at the first container too deep, instead of exhausting the stack
+	const std::size_t levels = 1000000;
+	std::vector<std::string> prefixes(levels);
+	std::size_t payload_size = 0;
+	for (std::size_t level = levels; level-- > 0; ) {
+		prefixes[level] = std::to_string(payload_size) + ":";
+		payload_size += prefixes[level].size() + 1;
+	}
+	std::string deep;
+	std::size_t too_deep_position = 0;
+	for (std::size_t level = 0; level < levels; level++) {
+		if (level == VALIDATE_DEPTH_MAX) {
+			too_deep_position = deep.size();
+		}
+		deep += prefixes[level];
+	}
+	deep.append(levels, ']');
+	result = validate(deep.data(), deep.size());
+	EXPECT_FALSE(result.ok) << "too deep nesting not recognized";
+	EXPECT_EQ(too_deep_position, result.position) << "error position does not match";
+	ASSERT_NE(nullptr, result.error) << "error not reported";
+	EXPECT_EQ(std::string("TNetstring nesting is too deep"), result.error) << "error does not match";
+	const std::string nested = "6:3:0:}]]";
+	EXPECT_TRUE(validate(nested.data(), nested.size(), 3).ok) << "nesting within the limit not recognized";
+	EXPECT_FALSE(validate(nested.data(), nested.size(), 2).ok) << "nesting beyond the limit not recognized";
+
+	// digit classification beyond sixteen characters
+	EXPECT_EQ(0, leading_digits("x0123456789012345678", "x0123456789012345678" + 20));
+	EXPECT_EQ(19, leading_digits("0123456789012345678x", "0123456789012345678x" + 20));
+	EXPECT_EQ(16, leading_digits("0123456789012345\xb0", "0123456789012345\xb0" + 17));
+	EXPECT_EQ(5, leading_digits("01234/6789012345678", "01234/6789012345678" + 19));
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Batch decoding of back-to-back TNetstrings, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Batch) {
+	try {
+	os_ << TNetstring_value(nested_dict(2, 2)) << TNetstring_value("Hello") << TNetstring_value(12345)
+			<< TNetstring_value(nested_list(2, 2)) << TNetstring_value(nullptr);
+	const std::string input = os_.str();
+	os_.str("");
+	std::vector<TNetstring_value> values;
+	std::vector<View> views;
+
+	// complete buffer
+	Batch_result result = decode_all(input.data(), input.size(), values);
+	EXPECT_EQ(5, result.count) << "count of decoded TNetstrings does not match";
+	EXPECT_EQ(input.size(), result.consumed) << "consumed size does not match";
+	EXPECT_EQ(0, result.incomplete) << "incomplete size does not match";
+	ASSERT_EQ(5, values.size()) << "count of decoded TNetstrings does not match";
+	for (const TNetstring_value& value : values) {
+		os_ << value;
+	}
+	EXPECT_EQ(input, os_.str()) << "decoded TNetstrings do not match";
+	os_.str("");
+
+	result = split_all(input.data(), input.size(), views);
+	EXPECT_EQ(5, result.count) << "count of split TNetstrings does not match";
+	ASSERT_EQ(5, views.size()) << "count of split TNetstrings does not match";
+	EXPECT_EQ("Hello", views[1].as_string_view()) << "viewed payload does not match";
+	EXPECT_EQ(TNETSTRING_TAG_NULL, views[4].type()) << "viewed type does not match";
+
+	// the buffer cut anywhere, the values are appended
+	for (std::size_t cut = 0; cut < input.size(); cut++) {
+		values.clear();
+		views.clear();
+		const Batch_result decoded = decode_all(input.data(), cut, values);
+		const Batch_result split = split_all(input.data(), cut, views);
+		EXPECT_EQ(cut, decoded.consumed + decoded.incomplete) << "sizes do not add up";
+		EXPECT_EQ(decoded.count, values.size()) << "count of decoded TNetstrings does not match";
+		EXPECT_EQ(decoded.consumed, split.consumed) << "split and decoded sizes differ";
+		EXPECT_EQ(decoded.count, split.count) << "split and decoded counts differ";
+
+		decode_all(input.data() + decoded.consumed, input.size() - decoded.consumed, values);
+		EXPECT_EQ(5, values.size()) << "count of decoded TNetstrings does not match";
+	}
+
+	// malformed TNetstrings are reported with their offset
+	const std::string malformed = "5:Hello,3:abc#0:~";
+	values.clear();
+	try {
+		decode_all(malformed.data(), malformed.size(), values);
+		FAIL() << "illegal integer not recognized";
+	} catch (Parse_exception& e) {
+		ASSERT_NE(nullptr, boost::get_error_info<Offset_info>(e)) << "offset not reported";
+		EXPECT_EQ(8, *boost::get_error_info<Offset_info>(e)) << "offset does not match";
+	}
+	// the TNetstrings before the failing one are kept, the failing one is not
+	ASSERT_EQ(1, values.size()) << "failing TNetstring left in values";
+	EXPECT_EQ("Hello", boost::get<std::string>(values[0])) << "decoded TNetstring does not match";
+	const std::string malformed_size = "5:Hello,3x:abc#0:~";
+	EXPECT_THROW(decode_all(malformed_size.data(), malformed_size.size(), values), Parse_exception)
+			<< "illegal size not recognized";
+	EXPECT_THROW(split_all(malformed_size.data(), malformed_size.size(), views), Parse_exception)
+			<< "illegal size not recognized";
+	EXPECT_THROW(split_all("1234567890", 10, views), Parse_exception) << "too large size not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Parallel batch decoding, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Batch_parallel) {
+	try {
+	const TNetstring_value records[] = {nested_dict(2, 2), "Hello", 12345, nested_list(2, 2), nullptr};
+	for (int i = 0; i < 1000; i++) {
+		os_ << records[i % 5];
+	}
+	os_ << "12:";
+	const std::string input = os_.str();
+	os_.str("");
+
+	std::vector<TNetstring_value> serial;
+	const Batch_result expected = decode_all(input.data(), input.size(), serial);
+	ASSERT_EQ(1000, expected.count) << "count of decoded TNetstrings does not match";
+
+	for (unsigned threads = 1; threads <= 8; threads *= 2) {
+		std::vector<TNetstring_value> values(1, "first");
+		const Batch_result result = decode_all_parallel(input.data(), input.size(), values, threads);
+		EXPECT_EQ(expected.count, result.count) << "count of decoded TNetstrings does not match";
+		EXPECT_EQ(expected.consumed, result.consumed) << "consumed size does not match";
+		EXPECT_EQ(3, result.incomplete) << "incomplete size does not match";
+		ASSERT_EQ(1001, values.size()) << "decoded TNetstrings are not appended";
+		for (std::size_t i = 0; i < serial.size(); i++) {
+			os_.str("");
+			os_ << serial[i];
+			const std::string serial_encoded = os_.str();
+			os_.str("");
+			os_ << values[i + 1];
+			ASSERT_EQ(serial_encoded, os_.str()) << "TNetstring " << i << " decoded on " << threads << " threads does not match";
+		}
+	}
+	os_.str("");
+
+	// the failing TNetstring is reported with its offset, the values are left unchanged
+	const std::string malformed = input.substr(0, expected.consumed) + "3:abc#" + input.substr(0, 1000);
+	std::vector<TNetstring_value> values(1, "first");
+	try {
+		decode_all_parallel(malformed.data(), malformed.size(), values, 4);
+		FAIL() << "illegal integer not recognized";
+	} catch (Parse_exception& e) {
+		ASSERT_NE(nullptr, boost::get_error_info<Offset_info>(e)) << "offset not reported";
+		EXPECT_EQ(expected.consumed, *boost::get_error_info<Offset_info>(e)) << "offset does not match";
+	}
+	EXPECT_EQ(1, values.size()) << "values changed by failed decoding";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Parallel decoding of a single large TNetstring, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Parallel_decoder) {
+	try {
+	const TNetstring_value records[] = {nested_dict(2, 2), "Hello", 12345, nested_list(2, 2), nullptr};
+	TNetstring_list list;
+	TNetstring_dict dict;
+	for (int i = 0; i < 500; i++) {
+		list.push_back(records[i % 5]);
+		dict["key" + std::to_string(i)] = records[i % 5];
+	}
+	list.push_back(dict);
+	os_ << TNetstring_value(list);
+	// duplicate keys keep their first value like Buffer_decoder
+	const std::string inputs[] = {os_.str(), "26:1:a,1:1#1:a,1:2#1:b,3:foo,}", "5:12345#", "0:]"};
+	os_.str("");
+
+	for (const std::string& input : inputs) {
+		TNetstring_value expected;
+		Buffer_decoder(input).decode(expected);
+		os_ << expected;
+		const std::string expected_encoded = os_.str();
+		os_.str("");
+
+		for (int levels = 0; levels <= 2; levels++) {
+			for (std::size_t threshold : {std::size_t(0), std::size_t(100), PARALLEL_DECODE_THRESHOLD}) {
+				TNetstring_value value;
+				ASSERT_EQ(input.size(), decode_parallel(input.data(), input.size(), value, 4, levels, threshold))
+						<< "consumed size does not match";
+				os_ << value;
+				ASSERT_EQ(expected_encoded, os_.str()) << "decoded TNetstring does not match, "
+						<< levels << " levels, threshold " << threshold;
+				os_.str("");
+			}
+		}
+	}
+
+	// malformed TNetstrings throw the same exception as Buffer_decoder
+	const std::string malformed[] = {"17:1:a,3:abc#1:b,0:~}", "10:3:abc#2:x#]", "12:1:a,1:b,1:c,}", "8:1:1#1:a,}",
+			"11:8:1:1#1:b,}]", "22:8:1:1#1:b,}8:1:1#1:b,}]"};
+	for (const std::string& input : malformed) {
+		std::string expected_error;
+		try {
+			Buffer_decoder(input).decode(tns_var_);
+			FAIL() << "malformed TNetstring " << input << " not recognized";
+		} catch (Parse_exception& e) {
+			expected_error = *boost::get_error_info<Error_msg_info>(e);
+		}
+		try {
+			decode_parallel(input.data(), input.size(), tns_var_, 4, 2, 0);
+			FAIL() << "malformed TNetstring " << input << " not recognized";
+		} catch (Parse_exception& e) {
+			EXPECT_EQ(expected_error, *boost::get_error_info<Error_msg_info>(e)) << "exception does not match";
+		}
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+#ifdef TNETSTRING_MAPPED_FILES
+/**
+ * Memory-mapped reading of back-to-back TNetstrings, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Mapped_reader) {
+	const std::string path = "test_tnetstring_mapped_reader.tns";
+	try {
+	const std::size_t count = 3 * Mapped_reader::SEEK_STRIDE + 10;
+	std::vector<std::size_t> offsets;
+	for (std::size_t i = 0; i < count; i++) {
+		offsets.push_back(os_.str().size());
+		os_ << TNetstring_value(static_cast<int>(i));
+	}
+	// a trailing TNetstring still being written
+	os_ << "12:abc";
+	const std::string archive = os_.str();
+	os_.str("");
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << archive;
+	}
+
+	Mapped_reader reader(path);
+	ASSERT_EQ(archive.size(), reader.size()) << "mapped size does not match";
+	View view;
+	std::size_t read = 0;
+	while (reader.next(view)) {
+		ASSERT_EQ(static_cast<int>(read), view.as_int()) << "viewed TNetstring does not match";
+		ASSERT_TRUE(view.data() >= reader.data() && view.data() < reader.data() + reader.size())
+				<< "viewed TNetstring is a copy";
+		read++;
+	}
+	EXPECT_EQ(count, read) << "count of TNetstrings does not match";
+	EXPECT_EQ(6, reader.remaining()) << "incomplete TNetstring not left over";
+
+	// seeking forwards, backwards and beyond the end
+	reader.advise(ACCESS_RANDOM);
+	for (std::size_t index : {std::size_t(5), std::size_t(2500), std::size_t(1024), std::size_t(0), count - 1}) {
+		ASSERT_TRUE(reader.seek(index)) << "seek to " << index << " failed";
+		EXPECT_EQ(index, reader.index()) << "index does not match";
+		EXPECT_EQ(offsets[index], reader.position()) << "offset of TNetstring " << index << " does not match";
+		ASSERT_TRUE(reader.next(view));
+		EXPECT_EQ(static_cast<int>(index), view.as_int()) << "viewed TNetstring does not match";
+	}
+	EXPECT_FALSE(reader.seek(count + 1)) << "seek beyond the end not recognized";
+	EXPECT_EQ(count, reader.index()) << "reader not left behind the last TNetstring";
+	reader.rewind();
+	ASSERT_TRUE(reader.next(view));
+	EXPECT_EQ(0, view.as_int()) << "rewind failed";
+
+	// malformed TNetstrings are reported with their offset
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << "1:1#1:2#x1:3#";
+	}
+	Mapped_reader malformed(path);
+	ASSERT_TRUE(malformed.next(view));
+	ASSERT_TRUE(malformed.next(view));
+	try {
+		malformed.next(view);
+		FAIL() << "malformed TNetstring not recognized";
+	} catch (Parse_exception& e) {
+		ASSERT_NE(nullptr, boost::get_error_info<Offset_info>(e)) << "offset not reported";
+		EXPECT_EQ(8, *boost::get_error_info<Offset_info>(e)) << "offset does not match";
+	}
+
+	// empty and missing files
+	{
+		std::ofstream file(path, std::ios::binary);
+	}
+	Mapped_reader empty(path);
+	EXPECT_FALSE(empty.next(view)) << "empty file not recognized";
+	EXPECT_TRUE(empty.seek(0)) << "seek to the beginning of an empty file failed";
+	std::remove(path.c_str());
+	EXPECT_THROW(Mapped_reader missing(path), Io_exception) << "missing file not recognized";
+
+	} catch (...) {
+		std::remove(path.c_str());
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Frame index sidecars, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Frame_index) {
+	const std::string data_path = "test_tnetstring_frame_index.tns";
+	const std::string index_path = "test_tnetstring_frame_index.idx";
+	const std::string keyed_path = "test_tnetstring_frame_index.kidx";
+	try {
+	std::remove(index_path.c_str());
+	std::remove(keyed_path.c_str());
+	std::vector<std::size_t> offsets;
+	auto append = [&](std::size_t first, std::size_t count) {
+		std::ofstream file(data_path, std::ios::binary | std::ios::app);
+		for (std::size_t i = first; i < first + count; i++) {
+			offsets.push_back(static_cast<std::size_t>(file.tellp()));
+			TNetstring_dict frame;
+			frame["seq"] = static_cast<int>(i);
+			frame["ts"] = static_cast<std::int64_t>(1000 + 10 * i);
+			file << TNetstring_value(frame);
+		}
+	};
+	std::remove(data_path.c_str());
+	append(0, 1000);
+
+	Frame_index_builder builder(data_path, index_path);
+	Frame_index_builder keyed_builder(data_path, keyed_path, "ts");
+	ASSERT_EQ(1000, builder.update()) << "count of indexed frames does not match";
+	ASSERT_EQ(1000, keyed_builder.update()) << "count of indexed frames does not match";
+	EXPECT_EQ(0, builder.update()) << "frames indexed twice";
+
+	// appended frames, and a frame still being written, are indexed incrementally
+	append(1000, 500);
+	{
+		std::ofstream file(data_path, std::ios::binary | std::ios::app);
+		file << "20:3:seq";
+	}
+	ASSERT_EQ(500, builder.update()) << "count of appended frames does not match";
+	ASSERT_EQ(500, keyed_builder.update()) << "count of appended frames does not match";
+
+	Frame_index index(index_path);
+	Frame_index keyed(keyed_path);
+	ASSERT_EQ(1500, index.count()) << "count of indexed frames does not match";
+	ASSERT_EQ(1500, keyed.count()) << "count of indexed frames does not match";
+	EXPECT_FALSE(index.keyed());
+	EXPECT_TRUE(keyed.keyed());
+	for (std::size_t i = 0; i < offsets.size(); i++) {
+		ASSERT_EQ(offsets[i], index.offset(i)) << "offset of frame " << i << " does not match";
+		ASSERT_EQ(offsets[i], keyed.offset(i)) << "offset of frame " << i << " does not match";
+		ASSERT_EQ(static_cast<std::int64_t>(1000 + 10 * i), keyed.key(i)) << "key of frame " << i << " does not match";
+	}
+
+	// seeking by index and by key
+	Mapped_reader reader(data_path, ACCESS_RANDOM);
+	View view;
+	ASSERT_TRUE(index.seek(reader, 1234));
+	ASSERT_TRUE(reader.next(view));
+	EXPECT_EQ(1234, view.find("seq").as_int()) << "frame does not match";
+	EXPECT_EQ(1235, reader.index()) << "index does not match";
+	EXPECT_FALSE(index.seek(reader, 1500)) << "frame beyond the index not recognized";
+	EXPECT_EQ(500, keyed.lower_bound(5995)) << "frame of key does not match";
+	EXPECT_EQ(500, keyed.lower_bound(6000)) << "frame of key does not match";
+	EXPECT_EQ(0, keyed.lower_bound(0)) << "frame of key does not match";
+	EXPECT_EQ(1500, keyed.lower_bound(100000)) << "frame of key does not match";
+
+	// mismatching sidecars and frames without key
+	EXPECT_THROW(Frame_index_builder(data_path, index_path, "ts").update(), Io_exception) << "mismatching sidecar not recognized";
+	EXPECT_THROW(Frame_index not_an_index(data_path), Io_exception) << "no sidecar not recognized";
+	std::remove(keyed_path.c_str());
+	EXPECT_THROW(Frame_index_builder(data_path, keyed_path, "time").update(), Type_exception) << "missing key not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+	std::remove(data_path.c_str());
+	std::remove(index_path.c_str());
+	std::remove(keyed_path.c_str());
+}
+#endif // TNETSTRING_MAPPED_FILES
+
+
+
+/**
+ * Skipping TNetstrings without decoding them, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Decoder_skip) {
+	try {
+	TNetstring_dict record;
+	for (int i = 0; i < 200; i++) {
+		record["field" + std::to_string(1000 + i)] = nested_list(2, 2);
+	}
+	record["field1010"] = "ten";
+	record["field1100"] = 100;
+	TNetstring_dict inner;
+	inner["a"] = 1;
+	inner["b"] = 2;
+	record["field1150"] = inner;
+	os_ << TNetstring_value(12345) << TNetstring_value(record) << TNetstring_value(std::string("Hello"));
+	is_.str(os_.str());
+	os_.str("");
+
+	Decoder decoder(is_);
+	decoder.skip();
+	decoder.enter_dict();
+	ASSERT_TRUE(decoder.skip_to_key("field1010")) << "key not found";
+	decoder.decode(tns_var_);
+	EXPECT_EQ("ten", boost::get<std::string>(tns_var_)) << "decoded value does not match";
+	ASSERT_TRUE(decoder.skip_to_key("field1100")) << "key not found";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(100, boost::get<int>(tns_var_)) << "decoded value does not match";
+	ASSERT_TRUE(decoder.skip_to_key("field1150")) << "key not found";
+	decoder.enter_dict();
+	ASSERT_TRUE(decoder.skip_to_key("b")) << "nested key not found";
+	decoder.decode(tns_var_);
+	EXPECT_EQ(2, boost::get<int>(tns_var_)) << "decoded value does not match";
+	EXPECT_FALSE(decoder.skip_to_key("a")) << "key before the position found";
+	EXPECT_FALSE(decoder.skip_to_key("field1100")) << "key before the position found";
+	decoder.decode(tns_var_);
+	EXPECT_EQ("Hello", boost::get<std::string>(tns_var_)) << "TNetstring behind the dict does not match";
+
+	// leaving a dict early, entering no dict
+	is_.clear();
+	is_.seekg(0);
+	decoder.skip();
+	decoder.enter_dict();
+	ASSERT_TRUE(decoder.skip_to_key("field1000")) << "key not found";
+	decoder.leave_dict();
+	EXPECT_THROW(decoder.enter_dict(), Type_exception) << "no dict not recognized";
+	decoder.decode(tns_var_);
+	EXPECT_EQ("Hello", boost::get<std::string>(tns_var_)) << "TNetstring behind the dict does not match";
+	EXPECT_THROW(decoder.skip_to_key("field1000"), Type_exception) << "no entered dict not recognized";
+
+	// malformed dicts
+	const std::string malformed[] = {"8:1:1#1:a,}", "8:1:a,4:b,}", "4:1:a,}", "8:1:a,z:b,}"};
+	for (const std::string& input : malformed) {
+		is_.clear();
+		is_.str(input);
+		Decoder malformed_decoder(is_);
+		malformed_decoder.enter_dict();
+		EXPECT_THROW(malformed_decoder.skip_to_key("x"), Parse_exception) << "malformed dict " << input << " not recognized";
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Path queries, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Path) {
+	try {
+	TNetstring_dict route;
+	route["shard"] = 7;
+	TNetstring_dict header;
+	header["route"] = route;
+	header["version"] = 2;
+	TNetstring_list items;
+	for (int i = 0; i < 5; i++) {
+		TNetstring_dict item;
+		item["price"] = 100.5 + i;
+		items.push_back(item);
+	}
+	TNetstring_dict message;
+	message["header"] = header;
+	message["items"] = items;
+	os_ << TNetstring_value(message);
+	const std::string input = os_.str();
+	os_.str("");
+
+	const Path shard("header.route.shard");
+	EXPECT_EQ(3, shard.length()) << "count of path segments does not match";
+	EXPECT_EQ(7, shard.evaluate(input.data(), input.size()).as_int()) << "extracted value does not match";
+	EXPECT_EQ(103.5, extract(input.data(), input.size(), Path("items[3].price")).as_double()) << "extracted value does not match";
+	EXPECT_EQ(5, std::distance(Path("items").evaluate(View(input)).begin(), Path("items").evaluate(View(input)).end()));
+	EXPECT_EQ(input.size(), Path("").evaluate(View(input)).size()) << "empty path does not view the root";
+
+	// missing keys and indices
+	EXPECT_FALSE(Path("header.route.table").evaluate(View(input))) << "missing key not recognized";
+	EXPECT_FALSE(Path("header.host.shard").evaluate(View(input))) << "missing key not recognized";
+	EXPECT_FALSE(Path("items[5].price").evaluate(View(input))) << "missing index not recognized";
+	EXPECT_THROW(Path("items.price").evaluate(View(input)), Type_exception) << "list as dict not recognized";
+	EXPECT_THROW(Path("header[0]").evaluate(View(input)), Type_exception) << "dict as list not recognized";
+
+	// malformed paths
+	for (const char* path : {"header..route", "items[x]", "items[3", "items[]", "items[3]price", ".header", "header."}) {
+		EXPECT_THROW(Path malformed(path), Parse_exception) << "malformed path " << path << " not recognized";
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Tape documents, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Document) {
+	try {
+	TNetstring_dict message;
+	message["name"] = std::string("Hello");
+	message["count"] = 12345;
+	message["big"] = std::numeric_limits<std::uint64_t>::max();
+	message["wide"] = std::numeric_limits<std::int64_t>::min();
+	message["price"] = 12.5;
+	message["flag"] = true;
+	message["none"] = nullptr;
+	message["items"] = nested_list(2, 3);
+	message["nested"] = nested_dict(2, 2);
+	os_ << TNetstring_value(message);
+	const std::string input = os_.str();
+	os_.str("");
+
+	Document document;
+	ASSERT_EQ(input.size(), document.parse(input.data(), input.size())) << "consumed size does not match";
+	const Document_node root = document.root();
+	ASSERT_EQ(TNETSTRING_TAG_DICT, root.type()) << "root type does not match";
+	EXPECT_EQ(2 * message.size(), root.size()) << "count of dict elements does not match";
+	EXPECT_EQ("Hello", root.find("name").as_string_view()) << "string does not match";
+	EXPECT_EQ(input.data() + input.find("4:name,5:Hello,") + 9, root.find("name").as_string_view().data()) << "string is a copy";
+	EXPECT_EQ(12345, root.find("count").as_int()) << "int does not match";
+	EXPECT_EQ(std::numeric_limits<std::uint64_t>::max(), root.find("big").as_uint64()) << "uint64 does not match";
+	EXPECT_EQ(std::numeric_limits<std::int64_t>::min(), root.find("wide").as_int64()) << "int64 does not match";
+	EXPECT_THROW(root.find("big").as_int64(), Parse_exception) << "out of range integer not recognized";
+	EXPECT_THROW(root.find("wide").as_int(), Parse_exception) << "out of range integer not recognized";
+	EXPECT_EQ(12.5, root.find("price").as_double()) << "double does not match";
+	EXPECT_TRUE(root.find("flag").as_bool()) << "bool does not match";
+	EXPECT_TRUE(root.find("none").is_null()) << "null does not match";
+	EXPECT_FALSE(root.find("missing")) << "missing key not recognized";
+	EXPECT_THROW(root.find("name").as_int(), Type_exception) << "wrong type not recognized";
+	EXPECT_THROW(root.at(0), Type_exception) << "dict as list not recognized";
+
+	// lists are walked like the variant tree
+	const TNetstring_list& items = boost::get<TNetstring_list>(message["items"]);
+	const Document_node items_node = root.find("items");
+	ASSERT_EQ(items.size(), items_node.size()) << "count of list elements does not match";
+	std::size_t i = 0;
+	for (const Document_node& element : items_node) {
+		if (element.type() == TNETSTRING_TAG_LIST) {
+			ASSERT_EQ(boost::get<TNetstring_list>(items[i]).size(), element.size()) << "nested list does not match";
+		}
+		i++;
+	}
+	EXPECT_EQ(items.size(), i) << "count of iterated elements does not match";
+	EXPECT_EQ(123, items_node.at(1).as_int()) << "list element does not match";
+	EXPECT_EQ(boost::get<TNetstring_list>(items[6]).size(), items_node.at(6).size()) << "list element does not match";
+	EXPECT_FALSE(items_node.at(items.size())) << "missing index not recognized";
+
+	// parsing again reuses the tape, malformed TNetstrings leave the document empty
+	const std::size_t node_count = document.node_count();
+	EXPECT_EQ(input.size(), document.parse(std::string(input))) << "consumed size does not match";
+	EXPECT_EQ(node_count, document.node_count()) << "count of nodes does not match";
+	EXPECT_EQ(12345, document.root().find("count").as_int()) << "int does not match";
+	const std::size_t allocations = allocation_count;
+	document.parse(input.data(), input.size());
+	EXPECT_EQ(allocations, allocation_count) << "parsing again allocated";
+	EXPECT_THROW(document.parse("10:3:abc#2:x#]"), Parse_exception) << "malformed TNetstring not recognized";
+	EXPECT_FALSE(document.root()) << "document of a malformed TNetstring not empty";
+
+	// copies of a document owning its buffer outlive the original
+	Document copy;
+	std::vector<Document> documents;
+	{
+		Document owner;
+		owner.parse(std::string("15:4:name,5:Hello,}"));
+		copy = owner;
+		for (int j = 0; j < 10; j++) {
+			documents.push_back(owner);
+		}
+	}
+	EXPECT_EQ("Hello", copy.root().find("name").as_string_view()) << "copied document does not match";
+	EXPECT_EQ("Hello", documents.front().root().find("name").as_string_view()) << "copied document does not match";
+	Document moved(std::move(documents.back()));
+	EXPECT_EQ("Hello", moved.root().find("name").as_string_view()) << "moved document does not match";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Hash and flat dict decoding, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Dicts) {
+	try {
+	// keys out of order and a duplicate key, which keeps its first value
+	const std::string input = "60:4:key3,11:1:a,4:true!]4:key1,5:Hello,4:key2,3:123#4:key1,0:~}";
+
+	Hash_value hash_value;
+	Hash_decoder hash_decoder(input);
+	EXPECT_EQ(input.size(), hash_decoder.decode(hash_value)) << "decoded size does not match";
+	ASSERT_EQ(typeid(Hash_dict), hash_value.type()) << "Decoded netstring value is not a dict";
+	const Hash_dict& hash_dict = boost::get<Hash_dict>(hash_value);
+	EXPECT_EQ(3, hash_dict.size()) << "decoded dict has wrong size";
+	EXPECT_EQ("Hello", boost::get<std::string>(hash_dict.at("key1")));
+	EXPECT_EQ(123, boost::get<int>(hash_dict.at("key2")));
+	EXPECT_EQ(2, boost::get<Hash_list>(hash_dict.at("key3")).size());
+	EXPECT_EQ("key3", hash_dict.begin()->first) << "elements are not in insertion order";
+	EXPECT_EQ(hash_dict.end(), hash_dict.find("key4")) << "missing key found";
+
+	Flat_value flat_value;
+	Flat_decoder flat_decoder(input);
+	EXPECT_EQ(input.size(), flat_decoder.decode(flat_value)) << "decoded size does not match";
+	ASSERT_EQ(typeid(Flat_dict), flat_value.type()) << "Decoded netstring value is not a dict";
+	const Flat_dict& flat_dict = boost::get<Flat_dict>(flat_value);
+	EXPECT_EQ(3, flat_dict.size()) << "decoded dict has wrong size";
+	EXPECT_EQ("Hello", boost::get<std::string>(flat_dict.at("key1")));
+	EXPECT_EQ(123, boost::get<int>(flat_dict.at("key2")));
+	EXPECT_EQ(2, boost::get<Flat_list>(flat_dict.at("key3")).size());
+	EXPECT_EQ("key1", flat_dict.begin()->first) << "elements are not sorted";
+	EXPECT_THROW(flat_dict.at("key4"), std::out_of_range) << "missing key found";
+
+	// growing beyond the reserved size
+	Hash_dict hash_dict_grown;
+	Flat_dict flat_dict_grown;
+	hash_dict_grown.reserve(4);
+	for (int i = 0; i < 5000; i++) {
+		const std::string key = std::to_string((i * 7919) % 5000);
+		ASSERT_TRUE(hash_dict_grown.emplace(key, i).second) << "key " << key << " not inserted";
+		ASSERT_TRUE(flat_dict_grown.emplace(key, i).second) << "key " << key << " not inserted";
+	}
+	for (int i = 0; i < 5000; i++) {
+		const std::string key = std::to_string((i * 7919) % 5000);
+		ASSERT_EQ(i, boost::get<int>(hash_dict_grown.at(key))) << "value of key " << key << " does not match";
+		ASSERT_EQ(i, boost::get<int>(flat_dict_grown.at(key))) << "value of key " << key << " does not match";
+	}
+	EXPECT_FALSE(hash_dict_grown.emplace("42", -1).second) << "duplicate key inserted";
+	EXPECT_FALSE(flat_dict_grown.emplace("42", -1).second) << "duplicate key inserted";
+	EXPECT_TRUE(std::is_sorted(flat_dict_grown.begin(), flat_dict_grown.end(),
+			[](const Flat_dict::value_type& a, const Flat_dict::value_type& b) { return a.first < b.first; }))
+			<< "elements are not sorted";
+
+	// errors are reported like with the std::map decoder
+	const std::string non_string_key = "8:1:1#1:b,}";
+	const std::string illegal_value = "8:1:a,1:b#}";
+	EXPECT_THROW(Hash_decoder(non_string_key).decode(hash_value), Parse_exception) << "non string key not recognized";
+	EXPECT_THROW(Flat_decoder(illegal_value).decode(flat_value), Parse_exception) << "illegal value not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TEST decoding with interned dict keys, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Interned_decoder) {
+	try {
+	const std::string input = "60:4:key3,11:1:a,4:true!]4:key1,5:Hello,4:key2,3:123#4:key1,0:~}";
+
+	Key_table keys;
+	Interned_value first;
+	Interned_value second;
+	EXPECT_EQ(input.size(), Interned_decoder(input, INT_NARROWEST, keys).decode(first)) << "decoded size does not match";
+	EXPECT_EQ(input.size(), Interned_decoder(input, INT_NARROWEST, keys).decode(second)) << "decoded size does not match";
+	EXPECT_EQ(3, keys.size()) << "repeated keys interned more than once";
+
+	ASSERT_EQ(typeid(Interned_dict), first.type()) << "Decoded netstring value is not a dict";
+	const Interned_dict& first_dict = boost::get<Interned_dict>(first);
+	const Interned_dict& second_dict = boost::get<Interned_dict>(second);
+	EXPECT_EQ(3, first_dict.size()) << "decoded dict has wrong size";
+	EXPECT_EQ("key3", first_dict.begin()->first.str()) << "elements are not in insertion order";
+	EXPECT_EQ(first_dict.begin()->first.id(), second_dict.begin()->first.id()) << "keys of both decodes differ";
+
+	// lookup by interned key
+	const Key key1 = keys.find("key1");
+	ASSERT_TRUE(static_cast<bool>(key1)) << "interned key not found";
+	EXPECT_EQ(key1.id(), keys.intern("key1").id()) << "interning again gave another key";
+	EXPECT_EQ("Hello", boost::get<std::string>(first_dict.at(key1))) << "duplicate key did not keep its first value";
+	EXPECT_EQ("Hello", boost::get<std::string>(second_dict.at(key1)));
+	EXPECT_EQ(123, boost::get<int>(second_dict.at(keys.find("key2"))));
+	EXPECT_FALSE(static_cast<bool>(keys.find("key4"))) << "missing key found";
+	EXPECT_EQ(first_dict.end(), first_dict.find(keys.find("key4"))) << "invalid key found";
+
+	// keys keep their address while the table grows
+	const std::string* key1_address = key1.id();
+	for (int i = 0; i < 5000; i++) {
+		keys.intern("field" + std::to_string(i));
+	}
+	EXPECT_EQ(5003, keys.size()) << "key table has wrong size";
+	EXPECT_EQ(key1_address, keys.find("key1").id()) << "interned key moved";
+	EXPECT_EQ("field4999", keys.find("field4999").str()) << "interned key has wrong name";
+
+	// errors are reported like with the std::map decoder
+	Interned_value value;
+	const std::string non_string_key = "8:1:1#1:b,}";
+	const std::string oversized_key = "8:9:a,1:b,}";
+	const std::string illegal_value = "8:1:a,1:b#}";
+	EXPECT_THROW(Interned_decoder(non_string_key, INT_NARROWEST, keys).decode(value), Parse_exception) << "non string key not recognized";
+	EXPECT_THROW(Interned_decoder(oversized_key, INT_NARROWEST, keys).decode(value), Parse_exception) << "oversized key not recognized";
+	EXPECT_THROW(Interned_decoder(illegal_value, INT_NARROWEST, keys).decode(value), Parse_exception) << "illegal value not recognized";
+
+	// the count of names is limited, clear() starts over
+	Key_table small_keys(2);
+	const std::string three_keys = "28:1:a,0:~1:b,0:~1:a,0:~1:c,0:~}";
+	EXPECT_THROW(Interned_decoder(three_keys, INT_NARROWEST, small_keys).decode(value), Parse_exception)
+			<< "key table limit not enforced";
+	EXPECT_EQ(2, small_keys.size()) << "key table has wrong size";
+	EXPECT_EQ(small_keys.find("a").id(), small_keys.intern("a").id()) << "interning a known name failed at the limit";
+	small_keys.clear();
+	EXPECT_EQ(0, small_keys.size()) << "key table not cleared";
+	EXPECT_FALSE(static_cast<bool>(small_keys.find("a"))) << "cleared key found";
+	EXPECT_TRUE(static_cast<bool>(small_keys.intern("c"))) << "interning after clear() failed";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Typed sample messages, fields in alphabetical order so they encode like a TNetstring_dict
+ */
+namespace typed_sample {
+
+struct Level {
+	double price;
+	std::int64_t quantity;
+};
+
+TNETSTRING_FIELDS(Level, price, quantity)
+
+struct Book {
+	boost::optional<Level> best;
+	std::vector<Level> bids;
+	int depth;
+	bool halted;
+	boost::optional<double> last;
+	std::uint64_t sequence;
+	std::string symbol;
+	std::map<std::string, int> venues;
+};
+
+TNETSTRING_FIELDS(Book, best, bids, depth, halted, last, sequence, symbol, venues)
+
+// variant path, for comparison
+TNetstring_value to_value(const Level& level) {
+	return TNetstring_dict {{"price", level.price}, {"quantity", level.quantity}};
+}
+
+TNetstring_value to_value(const Book& book) {
+	TNetstring_dict dict;
+	dict["best"] = book.best ? to_value(*book.best) : TNetstring_value(nullptr);
+	TNetstring_list bids;
+	for (const Level& level : book.bids) {
+		bids.push_back(to_value(level));
+	}
+	dict["bids"] = bids;
+	dict["depth"] = book.depth;
+	dict["halted"] = book.halted;
+	dict["last"] = book.last ? TNetstring_value(*book.last) : TNetstring_value(nullptr);
+	dict["sequence"] = book.sequence;
+	dict["symbol"] = book.symbol;
+	TNetstring_dict venues;
+	for (const std::pair<const std::string, int>& venue : book.venues) {
+		venues[venue.first] = venue.second;
+	}
+	dict["venues"] = venues;
+	return dict;
+}
+
+Level to_level(const TNetstring_value& value) {
+	const TNetstring_dict& dict = boost::get<TNetstring_dict>(value);
+	const TNetstring_value& quantity = dict.at("quantity");
+	Level level = {boost::get<double>(dict.at("price")),
+			quantity.type() == typeid(int) ? boost::get<int>(quantity) : boost::get<std::int64_t>(quantity)};
+	return level;
+}
+
+Book to_book(const TNetstring_value& value) {
+	const TNetstring_dict& dict = boost::get<TNetstring_dict>(value);
+	Book book;
+	if (dict.at("best").type() != typeid(const char*)) {
+		book.best = to_level(dict.at("best"));
+	}
+	for (const TNetstring_value& level : boost::get<TNetstring_list>(dict.at("bids"))) {
+		book.bids.push_back(to_level(level));
+	}
+	book.depth = boost::get<int>(dict.at("depth"));
+	book.halted = boost::get<bool>(dict.at("halted"));
+	if (dict.at("last").type() != typeid(const char*)) {
+		book.last = boost::get<double>(dict.at("last"));
+	}
+	const TNetstring_value& sequence = dict.at("sequence");
+	book.sequence = sequence.type() == typeid(int) ? boost::get<int>(sequence) : boost::get<std::uint64_t>(sequence);
+	book.symbol = boost::get<std::string>(dict.at("symbol"));
+	for (const std::pair<const std::string, TNetstring_value>& venue : boost::get<TNetstring_dict>(dict.at("venues"))) {
+		book.venues[venue.first] = boost::get<int>(venue.second);
+	}
+	return book;
+}
+
+Book sample_book(int levels) {
+	Book book;
+	book.best = Level {100.5, 300};
+	for (int i = 0; i < levels; i++) {
+		book.bids.push_back(Level {100.5 - i * 0.25, 100 + 10 * i});
+	}
+	book.depth = levels;
+	book.halted = false;
+	book.sequence = 18446744073709551615ull;
+	book.symbol = "ACME";
+	book.venues = {{"XNAS", 3}, {"XNYS", 7}};
+	return book;
+}
+
+} // ::typed_sample
+
+/**
+ * TEST typed encoding and decoding of structs, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Typed_codec) {
+	try {
+	using namespace typed_sample;
+	const Book book = sample_book(3);
+
+	// same bytes as the variant path
+	Typed_encoder encoder;
+	const std::string encoded = encoder.encode(book).to_string();
+	EXPECT_EQ(Buffer_encoder().encode(to_value(book)), encoded) << "typed encoding differs from the variant path";
+
+	Book decoded;
+	decoded.last = 1.0;
+	EXPECT_EQ(encoded.size(), decode_typed(encoded + "tail", decoded)) << "decoded size does not match";
+	ASSERT_TRUE(static_cast<bool>(decoded.best)) << "optional struct not decoded";
+	EXPECT_EQ(300, decoded.best->quantity);
+	ASSERT_EQ(3, decoded.bids.size()) << "list of structs has wrong size";
+	EXPECT_EQ(100.0, decoded.bids[2].price);
+	EXPECT_EQ(120, decoded.bids[2].quantity);
+	EXPECT_EQ(3, decoded.depth);
+	EXPECT_FALSE(decoded.halted);
+	EXPECT_FALSE(static_cast<bool>(decoded.last)) << "null did not reset the optional";
+	EXPECT_EQ(18446744073709551615ull, decoded.sequence);
+	EXPECT_EQ("ACME", decoded.symbol);
+	EXPECT_EQ(book.venues, decoded.venues);
+
+	// encoding again reuses the encoder, growing it for larger values
+	EXPECT_EQ(encoded, encoder.encode(book)) << "encoding again differs";
+	const std::string large = encoder.encode(sample_book(10000)).to_string();
+	EXPECT_EQ(Buffer_encoder().encode(to_value(sample_book(10000))), large) << "large typed encoding differs";
+	decode_typed(large, decoded);
+	EXPECT_EQ(10000, decoded.bids.size()) << "list of structs has wrong size";
+
+	// keys out of order, unknown keys skipped, missing fields keep their values
+	const std::string payload = "8:quantity,2:42#7:unknown,4:1:a,]5:price,3:1.5^";
+	Level level = {0.0, 7};
+	decode_typed(std::to_string(payload.size()) + ":" + payload + "}", level);
+	EXPECT_EQ(1.5, level.price);
+	EXPECT_EQ(42, level.quantity);
+	decode_typed("14:5:price,3:2.5^}", level);
+	EXPECT_EQ(2.5, level.price);
+	EXPECT_EQ(42, level.quantity) << "missing field did not keep its value";
+
+	// a field given more than once keeps its first value, like Buffer_decoder does
+	const std::string duplicate_payload = "5:price,3:3.5^5:price,3:4.5^8:quantity,1:1#8:quantity,1:2#";
+	const std::string duplicate = std::to_string(duplicate_payload.size()) + ":" + duplicate_payload + "}";
+	decode_typed(duplicate, level);
+	Buffer_decoder(duplicate).decode(tns_var_);
+	EXPECT_EQ(boost::get<double>(boost::get<TNetstring_dict>(tns_var_).at("price")), level.price)
+			<< "duplicate field did not keep its first value";
+	EXPECT_EQ(3.5, level.price) << "duplicate field did not keep its first value";
+	EXPECT_EQ(1, level.quantity) << "duplicate field did not keep its first value";
+
+	// errors
+	EXPECT_THROW(decode_typed("14:5:price,3:abc,}", level), Type_exception) << "wrong field type not recognized";
+	EXPECT_THROW(decode_typed("0:]", level), Type_exception) << "list decoded as struct";
+	EXPECT_THROW(decode_typed("10:1:1#3:2.5^}", level), Parse_exception) << "non string key not recognized";
+	EXPECT_THROW(decode_typed("8:5:price,}", level), Parse_exception) << "key without value not recognized";
+	EXPECT_THROW(decode_typed("14:5:price,3:2.5^", level), Parse_exception) << "truncated input not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * TEST message templates, using fixture Test_tnetstring_value
+ */
+TEST_F(Test_tnetstring_value, Message_template) {
+	try {
+	// keys in alphabetical order to compare with encoded TNetstring_dicts
+	Message_template heartbeat = Template_builder()
+			.begin_dict()
+				.key("seq").slot(TNETSTRING_TAG_INT)
+				.key("ts").slot(TNETSTRING_TAG_INT)
+				.key("type").value("heartbeat")
+			.end_dict()
+			.build();
+	EXPECT_EQ(2, heartbeat.slot_count()) << "template has wrong count of slots";
+
+	Buffer_encoder encoder;
+	TNetstring_dict expected {{"seq", 0}, {"ts", 0}, {"type", "heartbeat"}};
+	EXPECT_EQ(encoder.encode(expected), heartbeat.render()) << "unset slots not rendered as 0";
+
+	// slot values changing the count of size digits
+	for (std::int64_t seq : {std::int64_t(7), std::int64_t(-123456), std::int64_t(1) << 60}) {
+		heartbeat.set(0, seq);
+		heartbeat.set(1, std::uint64_t(18446744073709551615ull));
+		expected["seq"] = seq;
+		expected["ts"] = std::uint64_t(18446744073709551615ull);
+		ASSERT_EQ(encoder.encode(expected), heartbeat.render()) << "rendered heartbeat differs, seq " << seq;
+	}
+
+	// caller supplied buffer, no allocation
+	char buffer[128];
+	const std::size_t allocations = allocation_count;
+	const Encode_result result = heartbeat.render(buffer, sizeof(buffer));
+	EXPECT_EQ(allocations, allocation_count) << "rendering allocated";
+	ASSERT_TRUE(result.ok) << "rendering into buffer failed";
+	EXPECT_EQ(encoder.encode(expected), boost::string_view(buffer, result.size));
+	const Encode_result too_small = heartbeat.render(buffer, 10);
+	EXPECT_FALSE(too_small.ok) << "too small buffer not recognized";
+	EXPECT_EQ(result.size, too_small.size) << "required size does not match";
+
+	// nested containers and all slot types
+	Message_template request = Template_builder()
+			.begin_dict()
+				.key("args").begin_list()
+					.value("subscribe")
+					.slot(TNETSTRING_TAG_STRING)
+					.begin_list().slot(TNETSTRING_TAG_STRING).end_list()
+				.end_list()
+				.key("id").slot(TNETSTRING_TAG_INT)
+				.key("ok").slot(TNETSTRING_TAG_BOOLEAN)
+				.key("px").slot(TNETSTRING_TAG_FLOAT)
+			.end_dict()
+			.build();
+	const std::string topic(1000, 't');
+	request.set(0, topic);
+	request.set(1, "deep");
+	request.set(2, 42);
+	request.set(3, true);
+	request.set(4, 1.25);
+	TNetstring_dict nested {{"args", TNetstring_list {"subscribe", topic, TNetstring_list {"deep"}}},
+			{"id", 42}, {"ok", true}, {"px", 1.25}};
+	const std::string rendered = request.render().to_string();
+	EXPECT_EQ(encoder.encode(nested), rendered) << "rendered request differs";
+	Message_template copy = request;
+	request.set(0, "short");
+	nested["args"] = TNetstring_list {"subscribe", "short", TNetstring_list {"deep"}};
+	EXPECT_EQ(encoder.encode(nested), request.render()) << "rendered request differs after shrinking a slot";
+	EXPECT_EQ(rendered, copy.render()) << "copied template lost its slot values";
+
+	// integer slots take any integer type
+	nested["id"] = 5;
+	request.set(2, 5u);
+	EXPECT_EQ(encoder.encode(nested), request.render()) << "unsigned int slot value differs";
+	request.set(2, 5LL);
+	EXPECT_EQ(encoder.encode(nested), request.render()) << "long long slot value differs";
+	request.set(2, 5UL);
+	EXPECT_EQ(encoder.encode(nested), request.render()) << "unsigned long slot value differs";
+	nested["id"] = -5;
+	request.set(2, static_cast<short>(-5));
+	EXPECT_EQ(encoder.encode(nested), request.render()) << "short slot value differs";
+
+	// errors
+	EXPECT_THROW(request.set(2, "text"), Type_exception) << "wrong slot type not recognized";
+	EXPECT_THROW(request.set(5, 1), std::out_of_range) << "missing slot not recognized";
+	EXPECT_THROW(Template_builder().slot(TNETSTRING_TAG_LIST), Type_exception) << "unsupported slot type not recognized";
+	EXPECT_THROW(Template_builder().begin_dict().end_list(), Parse_exception) << "unbalanced containers not recognized";
+	EXPECT_THROW(Template_builder().begin_list().build(), Parse_exception) << "unclosed container not recognized";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Number kernel performance compared to boost::lexical_cast,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Numbers_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Numbers_performance_longrun) {
+#endif
+	const int repetitions = 1000000;
+	char buf[DOUBLE_FORMAT_MAXLEN];
+	volatile std::size_t sink = 0;
+
+	print_throughput("lexical_cast, int formatting", 10, repetitions, [&]() {
+		sink += boost::lexical_cast<std::string>(1234567890).size();
+	});
+	print_throughput("format_int", 10, repetitions, [&]() {
+		sink += format_int(1234567890, buf);
+	});
+
+	print_throughput("lexical_cast, double formatting", 18, repetitions / 10, [&]() {
+		sink += boost::lexical_cast<std::string>(12.345).size();
+	});
+	print_throughput("format_double", 6, repetitions / 10, [&]() {
+		sink += format_double(12.345, buf);
+	});
+
+	const std::string size_field = "123456789:";
+	print_throughput("lexical_cast, size parsing", 9, repetitions, [&]() {
+		sink += boost::lexical_cast<int>(size_field.data(), 9);
+	});
+	print_throughput("parse_size", 9, repetitions, [&]() {
+		std::size_t size;
+		sink += parse_size(size_field.data(), size_field.data() + size_field.size(), size);
+	});
+
+	print_throughput("lexical_cast, int parsing", 9, repetitions, [&]() {
+		sink += boost::lexical_cast<int>(size_field.data(), 9);
+	});
+	print_throughput("parse_int", 9, repetitions, [&]() {
+		int int_val;
+		sink += parse_int(size_field.data(), 9, int_val);
+	});
+
+	print_throughput("lexical_cast, double parsing", 6, repetitions / 10, [&]() {
+		sink += boost::lexical_cast<double>("12.345", 6);
+	});
+	print_throughput("parse_double", 6, repetitions / 10, [&]() {
+		double double_val;
+		sink += parse_double("12.345", 6, double_val);
+	});
+}
+
+
+
+/**
+ * Buffer_encoder performance on nested documents compared to the stream encoder,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Buffer_encoder_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Buffer_encoder_performance_longrun) {
+#endif
+	Buffer_encoder encoder;
+
+	const TNetstring_value documents[] = {nested_list(8, 2), nested_dict(8, 2)};
+	const std::string names[] = {"nested list", "nested dict"};
+
+	for (int i = 0; i < 2; i++) {
+		os_ << documents[i];
+		const std::size_t bytes = os_.str().size();
+		ASSERT_EQ(os_.str(), encoder.encode(documents[i]));
+
+		print_throughput("Encoder, " + names[i], bytes, 20, [&]() {
+			os_.str("");
+			os_ << documents[i];
+		});
+		print_throughput("Buffer_encoder, " + names[i], bytes, 20, [&]() {
+			encoder.encode(documents[i]);
+		});
+		os_.str("");
+	}
+}
+
+
+
+/**
+ * Decoder performance on nested documents of growing depth,
+ * the throughput should not drop with the depth,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Decoder_nested_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Decoder_nested_performance_longrun) {
+#endif
+	for (int depth = 2; depth <= 8; depth += 3) {
+		const TNetstring_value documents[] = {nested_list(depth, 2), nested_dict(depth, 2)};
+		const std::string names[] = {"nested list", "nested dict"};
+
+		for (int i = 0; i < 2; i++) {
+			os_.str("");
+			os_ << documents[i];
+			const std::string encoded = os_.str();
+			const int repetitions = 1 + (1 << 20) / static_cast<int>(encoded.size());
+			const std::string name = names[i] + " depth " + std::to_string(depth);
+
+			print_throughput("Decoder, " + name, encoded.size(), repetitions, [&]() {
+				is_.clear();
+				is_.str(encoded);
+				is_ >> tns_var_;
+			});
+			print_throughput("Buffer_decoder, " + name, encoded.size(), repetitions, [&]() {
+				Buffer_decoder decoder(encoded);
+				decoder.decode(tns_var_);
+			});
+		}
+	}
+	os_.str("");
+}
+
+
+
+/**
+ * Decode and destroy throughput of arena allocated documents compared to
+ * heap allocated ones, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Arena_decoder_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Arena_decoder_performance_longrun) {
+#endif
+	// typical dict messages of about 2 KB and 20 KB
+	const TNetstring_value documents[] = {nested_dict(2, 5), nested_dict(3, 6)};
+	Arena arena;
+
+	for (const TNetstring_value& document : documents) {
+		os_.str("");
+		os_ << document;
+		const std::string encoded = os_.str();
+		const int repetitions = (8 << 20) / static_cast<int>(encoded.size());
+		const std::string name = std::to_string(encoded.size()) + " bytes dict";
+
+		print_throughput("Buffer_decoder, " + name, encoded.size(), repetitions, [&]() {
+			TNetstring_value value;
+			Buffer_decoder decoder(encoded);
+			decoder.decode(value);
+		});
+		print_throughput("Arena_decoder, " + name, encoded.size(), repetitions, [&]() {
+			{
+				Arena_value value;
+				Arena_decoder decoder(encoded, INT_NARROWEST, arena);
+				decoder.decode(value);
+			}
+			arena.release();
+		});
+	}
+	os_.str("");
+}
+
+
+
+/**
+ * Push_parser performance on a frame arriving in pieces compared to decoding
+ * the collected data again after every piece, using fixture Test_tnetstring_value,
+ * long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Push_parser_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Push_parser_performance_longrun) {
+#endif
+	os_ << TNetstring_value(nested_dict(7, 3));
+	const std::string input = os_.str();
+	os_.str("");
+	const std::size_t piece = 4096;
+
+	print_throughput("Decoder retried per piece, " + std::to_string(input.size()) + " bytes", input.size(), 1, [&]() {
+		std::string collected;
+		for (std::size_t i = 0; i < input.size(); i += piece) {
+			collected.append(input, i, piece);
+			try {
+				is_.clear();
+				is_.str(collected);
+				is_ >> tns_var_;
+			} catch (Parse_exception&) {
+				// incomplete, retry with the next piece
+			}
+		}
+	});
+
+	Push_parser parser;
+	print_throughput("Push_parser, " + std::to_string(input.size()) + " bytes", input.size(), 1, [&]() {
+		for (std::size_t i = 0; i < input.size(); i += piece) {
+			parser.feed(input.data() + i, std::min(piece, input.size() - i));
+		}
+		parser.next(tns_var_);
+	});
+}
+
+
+
+/**
+ * Parser performance on nested documents compared to building trees,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Parser_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Parser_performance_longrun) {
+#endif
+	const TNetstring_value documents[] = {nested_list(8, 2), nested_dict(8, 2)};
+	const std::string names[] = {"nested list", "nested dict"};
+
+	for (int i = 0; i < 2; i++) {
+		os_.str("");
+		os_ << documents[i];
+		const std::string encoded = os_.str();
+
+		print_throughput("Buffer_decoder, " + names[i], encoded.size(), 20, [&]() {
+			Buffer_decoder decoder(encoded);
+			decoder.decode(tns_var_);
+		});
+		print_throughput("Parser, counting " + names[i], encoded.size(), 20, [&]() {
+			Value_counter counter;
+			parse(encoded.data(), encoded.size(), counter);
+		});
+	}
+	os_.str("");
+}
+
+
+
+/**
+ * Validation performance on nested documents compared to decoding,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Validate_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Validate_performance_longrun) {
+#endif
+	const TNetstring_value documents[] = {nested_list(8, 2), nested_dict(8, 2)};
+	const std::string names[] = {"nested list", "nested dict"};
+
+	for (int i = 0; i < 2; i++) {
+		os_.str("");
+		os_ << documents[i];
+		const std::string encoded = os_.str();
+		ASSERT_TRUE(validate(encoded.data(), encoded.size()).ok);
+
+		print_throughput("Buffer_decoder, " + names[i], encoded.size(), 20, [&]() {
+			Buffer_decoder decoder(encoded);
+			decoder.decode(tns_var_);
+		});
+		print_throughput("View::validate, " + names[i], encoded.size(), 20, [&]() {
+			View(encoded).validate();
+		});
+		print_throughput("validate, " + names[i], encoded.size(), 20, [&]() {
+			validate(encoded.data(), encoded.size());
+		});
+	}
+	os_.str("");
+}
+
+
+
+/**
+ * Replay of a file of back-to-back TNetstrings, batch decoding compared to
+ * the stream operator, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Batch_replay_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Batch_replay_performance_longrun) {
+#endif
+	// generated replay file of about 8 MB
+	const TNetstring_value records[] = {nested_dict(1, 2), nested_list(1, 3), "Hello", 12345, nullptr};
+	for (std::size_t i = 0; os_.tellp() < (8 << 20); i++) {
+		os_ << records[i % 5];
+	}
+	const std::string replay = os_.str();
+	os_.str("");
+	std::vector<TNetstring_value> values;
+	std::vector<View> views;
+
+	print_throughput("operator>>, replay", replay.size(), 1, [&]() {
+		is_.clear();
+		is_.str(replay);
+		while (is_.peek() != EOF) {
+			is_ >> tns_var_;
+		}
+	});
+	print_throughput("decode_all, replay", replay.size(), 1, [&]() {
+		values.clear();
+		decode_all(replay.data(), replay.size(), values);
+	});
+	print_throughput("split_all, replay", replay.size(), 1, [&]() {
+		views.clear();
+		split_all(replay.data(), replay.size(), views);
+	});
+	EXPECT_EQ(values.size(), views.size()) << "split and decoded counts differ";
+}
+
+
+
+/**
+ * Parallel batch decoding scaling with the count of threads,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Batch_parallel_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Batch_parallel_performance_longrun) {
+#endif
+	// generated replay file of about 8 MB
+	const TNetstring_value records[] = {nested_dict(1, 2), nested_list(1, 3), "Hello", 12345, nullptr};
+	for (std::size_t i = 0; os_.tellp() < (8 << 20); i++) {
+		os_ << records[i % 5];
+	}
+	const std::string replay = os_.str();
+	os_.str("");
+	std::vector<TNetstring_value> values;
+
+	const unsigned max_threads = std::max(4u, default_thread_count());
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		print_throughput("decode_all_parallel, " + std::to_string(threads) + " threads", replay.size(), 1, [&]() {
+			values.clear();
+			decode_all_parallel(replay.data(), replay.size(), values, threads);
+		});
+	}
+}
+
+
+
+/**
+ * Parallel decoding of a single large TNetstring performance,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Parallel_decoder_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Parallel_decoder_performance_longrun) {
+#endif
+	// generated snapshot of about 8 MB, one top-level list
+	const TNetstring_value records[] = {nested_dict(1, 2), nested_list(1, 3), "Hello", 12345, nullptr};
+	TNetstring_list list;
+	for (std::size_t i = 0; i < 60000; i++) {
+		list.push_back(records[i % 5]);
+	}
+	os_ << TNetstring_value(list);
+	const std::string snapshot = os_.str();
+	os_.str("");
+	list.clear();
+
+	print_throughput("Buffer_decoder, snapshot", snapshot.size(), 1, [&]() {
+		Buffer_decoder(snapshot).decode(tns_var_);
+	});
+	const unsigned max_threads = std::max(4u, default_thread_count());
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		print_throughput("decode_parallel, " + std::to_string(threads) + " threads", snapshot.size(), 1, [&]() {
+			decode_parallel(snapshot.data(), snapshot.size(), tns_var_, threads);
+		});
+	}
+}
+
+
+
+#ifdef TNETSTRING_MAPPED_FILES
+/**
+ * Memory-mapped reading performance compared to std::ifstream,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Mapped_reader_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Mapped_reader_performance_longrun) {
+#endif
+	// generated archive of about 2 MB, std::ifstream is slow
+	const std::string path = "test_tnetstring_mapped_reader.tns";
+	const TNetstring_value records[] = {nested_dict(1, 2), nested_list(1, 3), "Hello", 12345, nullptr};
+	{
+		std::ofstream file(path, std::ios::binary);
+		for (std::size_t i = 0; file.tellp() < (2 << 20); i++) {
+			file << records[i % 5];
+		}
+	}
+	std::size_t size;
+	{
+		Mapped_reader reader(path);
+		size = reader.size();
+	}
+
+	print_throughput("std::ifstream, decoding", size, 1, [&]() {
+		std::ifstream file(path, std::ios::binary);
+		while (file.peek() != std::char_traits<char>::eof()) {
+			file >> tns_var_;
+		}
+	});
+	print_throughput("Mapped_reader, scanning", size, 1, [&]() {
+		Mapped_reader reader(path);
+		View view;
+		while (reader.next(view)) {
+		}
+	});
+	print_throughput("Mapped_reader, decoding", size, 1, [&]() {
+		Mapped_reader reader(path);
+		View view;
+		while (reader.next(view)) {
+			Buffer_decoder(view.data(), view.size()).decode(tns_var_);
+		}
+	});
+	std::remove(path.c_str());
+}
+#endif // TNETSTRING_MAPPED_FILES
+
+
+
+/**
+ * Skipping performance, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Decoder_skip_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Decoder_skip_performance_longrun) {
+#endif
+	// 3 fields of a 200 field record
+	TNetstring_dict record;
+	for (int i = 0; i < 200; i++) {
+		record["field" + std::to_string(1000 + i)] = nested_list(1, 4);
+	}
+	os_ << TNetstring_value(record);
+	const std::string input = os_.str();
+	os_.str("");
+	const int repetitions = 100;
+
+	print_throughput("Decoder, all fields", input.size(), repetitions, [&]() {
+		is_.clear();
+		is_.str(input);
+		Decoder(is_).decode(tns_var_);
+	});
+	print_throughput("Decoder, skip_to_key 3 fields", input.size(), repetitions, [&]() {
+		is_.clear();
+		is_.str(input);
+		Decoder decoder(is_);
+		decoder.enter_dict();
+		for (const char* key : {"field1020", "field1100", "field1180"}) {
+			decoder.skip_to_key(key);
+			decoder.decode(tns_var_);
+		}
+		decoder.leave_dict();
+	});
+}
+
+
+
+/**
+ * Path query performance, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Path_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Path_performance_longrun) {
+#endif
+	// message with a header in front of a 50 field body
+	TNetstring_dict route;
+	route["shard"] = 7;
+	TNetstring_dict header;
+	header["route"] = route;
+	TNetstring_dict message;
+	message["body"] = nested_dict(1, 50);
+	message["header"] = header;
+	os_ << TNetstring_value(message);
+	const std::string input = os_.str();
+	os_.str("");
+	const int repetitions = 20000;
+
+	const Path shard("header.route.shard");
+	volatile int sink = 0;
+	print_throughput("Buffer_decoder, header.route.shard", input.size(), repetitions / 10, [&]() {
+		Buffer_decoder(input).decode(tns_var_);
+		const TNetstring_dict& dict = boost::get<TNetstring_dict>(tns_var_);
+		const TNetstring_dict& header_dict = boost::get<TNetstring_dict>(dict.at("header"));
+		sink = boost::get<int>(boost::get<TNetstring_dict>(header_dict.at("route")).at("shard"));
+	});
+	print_throughput("Path, header.route.shard", input.size(), repetitions, [&]() {
+		sink = shard.evaluate(input.data(), input.size()).as_int();
+	});
+	std::cout << "[   PERF   ] Path evaluations: " << repetitions << ", last value " << sink << std::endl;
+}
+
+
+
+/**
+ * Tape document performance compared to the TNetstring_value tree,
+ * using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Document_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Document_performance_longrun) {
+#endif
+	// about 2 MB of nested containers
+	TNetstring_list records;
+	for (int i = 0; i < 1500; i++) {
+		records.push_back(nested_dict(2, 4));
+	}
+	os_ << TNetstring_value(records);
+	const std::string input = os_.str();
+	os_.str("");
+	records.clear();
+	const int repetitions = 3;
+
+	print_throughput("TNetstring_value, decoding", input.size(), repetitions, [&]() {
+		Buffer_decoder(input).decode(tns_var_);
+	});
+	Document document;
+	print_throughput("Document, decoding", input.size(), repetitions, [&]() {
+		document.parse(input.data(), input.size());
+	});
+
+	// count the integers of the whole tree
+	std::function<std::size_t(const TNetstring_value&)> count_tree = [&](const TNetstring_value& value) -> std::size_t {
+		if (const TNetstring_list* list = boost::get<TNetstring_list>(&value)) {
+			std::size_t count = 0;
+			for (const TNetstring_value& element : *list) {
+				count += count_tree(element);
+			}
+			return count;
+		} else if (const TNetstring_dict* dict = boost::get<TNetstring_dict>(&value)) {
+			std::size_t count = 0;
+			for (const TNetstring_dict::value_type& element : *dict) {
+				count += count_tree(element.second);
+			}
+			return count;
+		}
+		return value.type() == typeid(int) ? 1 : 0;
+	};
+	std::function<std::size_t(const Document_node&)> count_tape = [&](const Document_node& node) -> std::size_t {
+		if (node.type() == TNETSTRING_TAG_LIST || node.type() == TNETSTRING_TAG_DICT) {
+			std::size_t count = 0;
+			for (const Document_node& element : node) {
+				count += count_tape(element);
+			}
+			return count;
+		}
+		return node.type() == TNETSTRING_TAG_INT ? 1 : 0;
+	};
+	std::size_t tree_count = 0;
+	std::size_t tape_count = 0;
+	print_throughput("TNetstring_value, traversal", input.size(), repetitions * 10, [&]() {
+		tree_count = count_tree(tns_var_);
+	});
+	print_throughput("Document, traversal", input.size(), repetitions * 10, [&]() {
+		tape_count = count_tape(document.root());
+	});
+	EXPECT_EQ(tree_count, tape_count) << "count of integers does not match";
+}
+
+
+
+/**
+ * Dict representation performance, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Dicts_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Dicts_performance_longrun) {
+#endif
+	for (int count : {4, 32, 512, 10000}) {
+		TNetstring_dict dict;
+		std::vector<std::string> keys;
+		for (int i = 0; i < count; i++) {
+			keys.push_back("field" + std::to_string(i));
+			dict[keys.back()] = i;
+		}
+		os_.str("");
+		os_ << TNetstring_value(dict);
+		const std::string input = os_.str();
+		os_.str("");
+		const int repetitions = std::max(1, 200000 / count);
+		const std::string suffix = ", " + std::to_string(count) + " keys";
+		volatile std::size_t sink = 0;
+
+		// insert: decoding the dict
+		Hash_value hash_value;
+		Flat_value flat_value;
+		print_throughput("std::map, decoding" + suffix, input.size(), repetitions, [&]() {
+			Buffer_decoder(input).decode(tns_var_);
+		});
+		print_throughput("Hash_dict, decoding" + suffix, input.size(), repetitions, [&]() {
+			Hash_decoder(input).decode(hash_value);
+		});
+		print_throughput("Flat_dict, decoding" + suffix, input.size(), repetitions, [&]() {
+			Flat_decoder(input).decode(flat_value);
+		});
+
+		// lookup: every key once, throughput of the keys looked up
+		const TNetstring_dict& map = boost::get<TNetstring_dict>(tns_var_);
+		const Hash_dict& hash_dict = boost::get<Hash_dict>(hash_value);
+		const Flat_dict& flat_dict = boost::get<Flat_dict>(flat_value);
+		print_throughput("std::map, lookup" + suffix, input.size(), repetitions, [&]() {
+			for (const std::string& key : keys) {
+				sink = sink + (map.find(key) != map.end());
+			}
+		});
+		print_throughput("Hash_dict, lookup" + suffix, input.size(), repetitions, [&]() {
+			for (const std::string& key : keys) {
+				sink = sink + (hash_dict.find(key) != hash_dict.end());
+			}
+		});
+		print_throughput("Flat_dict, lookup" + suffix, input.size(), repetitions, [&]() {
+			for (const std::string& key : keys) {
+				sink = sink + (flat_dict.find(key) != flat_dict.end());
+			}
+		});
+	}
+}
+
+
+
+/**
+ * Interned dict key performance compared to std::string keys, on messages repeating the same keys
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Interned_decoder_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Interned_decoder_performance_longrun) {
+#endif
+	// market data like messages, keys too long for the small string buffer
+	const std::vector<std::string> fields {"instrument_identifier", "exchange_timestamp", "receive_timestamp",
+			"sequence_number", "best_bid_price", "best_bid_quantity", "best_ask_price", "best_ask_quantity",
+			"last_trade_price", "last_trade_quantity", "trading_session_state", "market_segment_identifier"};
+	const int count = 20000;
+	std::string input;
+	std::vector<std::size_t> offsets;
+	for (int i = 0; i < count; i++) {
+		TNetstring_dict message;
+		for (std::size_t f = 0; f < fields.size(); f++) {
+			message[fields[f]] = static_cast<int>(i * fields.size() + f);
+		}
+		os_.str("");
+		os_ << TNetstring_value(message);
+		offsets.push_back(input.size());
+		input += os_.str();
+	}
+	os_.str("");
+	offsets.push_back(input.size());
+
+	// heap bytes in use while all the messages are kept decoded
+	const auto heap_in_use = [&](std::function<void()> decode_all) {
+		const std::size_t before = allocated_bytes;
+		decode_all();
+		return allocated_bytes - before;
+	};
+	std::size_t sizes[3];
+	{
+		std::vector<TNetstring_value> values(count);
+		sizes[0] = heap_in_use([&]() {
+			for (int i = 0; i < count; i++) {
+				Buffer_decoder(input.data() + offsets[i], offsets[i + 1] - offsets[i]).decode(values[i]);
+			}
+		});
+	}
+	{
+		std::vector<Hash_value> values(count);
+		sizes[1] = heap_in_use([&]() {
+			for (int i = 0; i < count; i++) {
+				Hash_decoder(input.data() + offsets[i], offsets[i + 1] - offsets[i]).decode(values[i]);
+			}
+		});
+	}
+	{
+		Key_table keys;
+		std::vector<Interned_value> values(count);
+		sizes[2] = heap_in_use([&]() {
+			for (int i = 0; i < count; i++) {
+				Interned_decoder(input.data() + offsets[i], offsets[i + 1] - offsets[i], INT_NARROWEST, keys).decode(values[i]);
+			}
+		});
+		EXPECT_EQ(fields.size(), keys.size()) << "repeated keys interned more than once";
+	}
+	std::cout << "[   PERF   ] heap in use for " << count << " messages, std::map: " << sizes[0] / 1024
+			<< " KB, Hash_dict: " << sizes[1] / 1024 << " KB, Interned_dict: " << sizes[2] / 1024 << " KB" << std::endl;
+	EXPECT_LT(sizes[2], sizes[1]) << "interned keys do not save memory";
+
+	// decoding all messages
+	TNetstring_value value;
+	Hash_value hash_value;
+	Interned_value interned_value;
+	Key_table keys;
+	print_throughput("std::map, decoding", input.size(), 5, [&]() {
+		for (Buffer_decoder decoder(input); decoder.position() < input.size(); ) {
+			decoder.decode(value);
+		}
+	});
+	print_throughput("Hash_dict, decoding", input.size(), 5, [&]() {
+		for (Hash_decoder decoder(input); decoder.position() < input.size(); ) {
+			decoder.decode(hash_value);
+		}
+	});
+	print_throughput("Interned_dict, decoding", input.size(), 5, [&]() {
+		for (Interned_decoder decoder(input, INT_NARROWEST, keys); decoder.position() < input.size(); ) {
+			decoder.decode(interned_value);
+		}
+	});
+
+	// looking up every field of a message
+	const Hash_dict& hash_dict = boost::get<Hash_dict>(hash_value);
+	const Interned_dict& interned_dict = boost::get<Interned_dict>(interned_value);
+	std::vector<Key> field_keys;
+	for (const std::string& field : fields) {
+		field_keys.push_back(keys.find(field));
+	}
+	volatile std::size_t sink = 0;
+	print_throughput("Hash_dict, lookup", offsets[1], 100000, [&]() {
+		for (const std::string& field : fields) {
+			sink = sink + (hash_dict.find(field) != hash_dict.end());
+		}
+	});
+	print_throughput("Interned_dict, lookup", offsets[1], 100000, [&]() {
+		for (const Key& key : field_keys) {
+			sink = sink + (interned_dict.find(key) != interned_dict.end());
+		}
+	});
+}
+
+
+
+/**
+ * Typed struct codec performance compared to the TNetstring_value path
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Typed_codec_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Typed_codec_performance_longrun) {
+#endif
+	using namespace typed_sample;
+	const Book book = sample_book(20);
+	const int repetitions = 10000;
+
+	Typed_encoder typed_encoder;
+	Buffer_encoder buffer_encoder;
+	const std::string input = typed_encoder.encode(book).to_string();
+	print_throughput("variant path, encoding", input.size(), repetitions, [&]() {
+		buffer_encoder.encode(to_value(book));
+	});
+	print_throughput("typed, encoding", input.size(), repetitions, [&]() {
+		typed_encoder.encode(book);
+	});
+
+	Book decoded;
+	print_throughput("variant path, decoding", input.size(), repetitions, [&]() {
+		Buffer_decoder(input).decode(tns_var_);
+		decoded = to_book(tns_var_);
+	});
+	EXPECT_EQ(20, decoded.bids.size()) << "variant path decoded wrong size";
+	decoded = Book();
+	print_throughput("typed, decoding", input.size(), repetitions, [&]() {
+		decode_typed(input, decoded);
+	});
+	EXPECT_EQ(20, decoded.bids.size()) << "typed decoded wrong size";
+}
+
+
+
+/**
+ * Message template performance compared to encoding the message each time
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Message_template_performance_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Message_template_performance_longrun) {
+#endif
+	Message_template heartbeat = Template_builder()
+			.begin_dict()
+				.key("channel").value("market-data-primary")
+				.key("seq").slot(TNETSTRING_TAG_INT)
+				.key("status").value("alive")
+				.key("ts").slot(TNETSTRING_TAG_INT)
+				.key("type").value("heartbeat")
+			.end_dict()
+			.build();
+	TNetstring_dict dict {{"channel", "market-data-primary"}, {"seq", 0}, {"status", "alive"},
+			{"ts", std::int64_t(0)}, {"type", "heartbeat"}};
+	const std::int64_t ts = 1700000000000000000ll;
+	const std::size_t size = heartbeat.render().size();
+	const int repetitions = 300000;
+
+	int seq = 0;
+	print_throughput("Encoder, heartbeat", size, repetitions / 10, [&]() {
+		dict["seq"] = ++seq;
+		dict["ts"] = ts + seq;
+		os_.str("");
+		os_ << TNetstring_value(dict);
+	});
+	Buffer_encoder encoder;
+	print_throughput("Buffer_encoder, heartbeat", size, repetitions, [&]() {
+		dict["seq"] = ++seq;
+		dict["ts"] = ts + seq;
+		encoder.encode(dict);
+	});
+	char buffer[256];
+	print_throughput("Message_template, heartbeat", size, repetitions, [&]() {
+		heartbeat.set(0, ++seq);
+		heartbeat.set(1, ts + seq);
+		heartbeat.render(buffer, sizeof(buffer));
+	});
+	dict["seq"] = seq;
+	dict["ts"] = ts + seq;
+	EXPECT_EQ(encoder.encode(dict), heartbeat.render()) << "rendered heartbeat differs";
+}
+
+
+
+/**
+ * TNetstring payload decoding, using fixture Test_tnetstring_value, long running tests
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Decoder_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Decoder_longrun) {
+#endif
+	try {
+	std::string remains;
+
+	// create maxlen string with 999999999 characters
+	std::string append_str = "abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghi,";
+	std::string str(append_str);
+	for (int i=0;i<tnetstring::TNETSTRING_DATA_MAXLEN/100;i++) {
+		// append 100 characters
+		str.append(append_str);
+	} // 100 * 9999999 + 99 + ","
+	std::string teststr = "999999999:";
+	teststr.append(str);
+	teststr.append("asdf");
+	is_.str(teststr);
+	is_ >> tns_var_;
+	ASSERT_EQ(typeid(std::string), tns_var_.type()) << "Decoded netstring value is not a string";
+	EXPECT_EQ(999999999, boost::get<std::string>(tns_var_).size()) << "decoded payload has wrong size";
+	is_ >> remains;
+	EXPECT_EQ("asdf", remains) << "Stream remainings are wrong";
+	is_.clear(); // ... we read until eos
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Buffer encoding of containers exceeding TNETSTRING_DATA_MAXLEN, using fixture Test_tnetstring_value
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Buffer_encoder_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Buffer_encoder_longrun) {
+#endif
+	try {
+	// list payload of 1000000022 bytes, cut after TNETSTRING_DATA_MAXLEN like the stream encoder does
+	const std::string element(500000000, 'x');
+	const TNetstring_value list = TNetstring_list {element.c_str(), element.c_str()};
+	const std::size_t maxlen = TNETSTRING_DATA_MAXLEN;
+	ASSERT_EQ(maxlen + 11, encoded_size(list)) << "encoded size is not cut";
+
+	const auto check = [&](const char* data, std::size_t size) {
+		ASSERT_EQ(maxlen + 11, size) << "encoded list is not cut";
+		EXPECT_EQ("999999999:500000000:", std::string(data, 20)) << "encoded list does not match";
+		EXPECT_EQ(",500000000:", std::string(data + 20 + 500000000, 11)) << "encoded list does not match";
+		EXPECT_EQ("xx]", std::string(data + size - 3, 3)) << "encoded list does not match";
+	};
+	{
+		Buffer_encoder encoder;
+		const boost::string_view encoded = encoder.encode(list);
+		check(encoded.data(), encoded.size());
+	}
+	{
+		std::vector<char> buffer(maxlen + 11);
+		const Encode_result result = encode_to(buffer.data(), buffer.size(), list);
+		ASSERT_TRUE(result.ok) << "encoding into buffer failed";
+		check(buffer.data(), result.size);
+	}
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Typed encoding of containers exceeding TNETSTRING_DATA_MAXLEN, using fixture Test_tnetstring_value
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Typed_codec_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Typed_codec_longrun) {
+#endif
+	try {
+	// list payload of 1000000022 bytes, cut after TNETSTRING_DATA_MAXLEN like the stream encoder does
+	const std::vector<std::string> list(2, std::string(500000000, 'x'));
+	const std::size_t maxlen = TNETSTRING_DATA_MAXLEN;
+	Typed_encoder encoder;
+	const boost::string_view encoded = encoder.encode(list);
+	ASSERT_EQ(maxlen + 11, encoded.size()) << "encoded list is not cut";
+	EXPECT_EQ("999999999:500000000:", encoded.substr(0, 20)) << "encoded list does not match";
+	EXPECT_EQ(",500000000:", encoded.substr(20 + 500000000, 11)) << "encoded list does not match";
+	EXPECT_EQ("xx]", encoded.substr(encoded.size() - 3)) << "encoded list does not match";
+
+	} catch (...) {
+		std::cerr << boost::current_exception_diagnostic_information();
+		FAIL();
+	}
+}
+
+
+
+/**
+ * Message templates with slots exceeding TNETSTRING_DATA_MAXLEN, using fixture Test_tnetstring_value
+ */
+#ifdef DISABLE_LONGRUN_TESTS
+TEST_F(Test_tnetstring_value, DISABLED_Message_template_longrun) {
+#else
+TEST_F(Test_tnetstring_value, Message_template_longrun) {
+#endif
+	try {
+	const std::string oversized(1000000000, 'x');
+	const std::size_t maxlen = TNETSTRING_DATA_MAXLEN;
+
+	// string slots are cut like by the encoders
+	Message_template message = Template_builder().slot(TNETSTRING_TAG_STRING).build();
+	message.set(0, oversized);
+	const boost::string_view rendered = message.render();
+	ASSERT_EQ(maxlen + 11, rendered.size()) << "rendered string is not cut";
+	EXPECT_EQ("999999999:xx", rendered.substr(0, 12)) << "rendered string does not match";
+	EXPECT_EQ("xx,", rendered.substr(rendered.size() - 3)) << "rendered string does not match";
+
+	// containers exceeding the limit are rejected instead of getting an undecodable size field
+	Message_template list = Template_builder().begin_list().slot(TNETSTRING_TAG_STRING).end_list().build();
+	list.set(0, oversized);
+	EXPECT_THROW(list.render(), Parse_exception) << "oversized container not recognized";
+	char buffer[16];
+	EXPECT_THROW(list.render(buffer, sizeof(buffer)), Parse_exception) << "oversized container not recognized";
 
 	} catch (...) {
 		std::cerr << boost::current_exception_diagnostic_information();
@@ -8,7 +8,30 @@
 
 #include "detail/constants.hpp"
 #include "detail/types.hpp"
+#include "detail/arena.hpp"
+#include "detail/dicts.hpp"
 #include "detail/exceptions.hpp"
+#include "detail/key_table.hpp"
+#include "detail/numbers.hpp"
+#include "detail/encoded_size.hpp"
 #include "detail/encoder.hpp"
+#include "detail/buffer_encoder.hpp"
+#include "detail/message_template.hpp"
 #include "detail/decoder.hpp"
+#include "detail/buffer_decoder.hpp"
+#include "detail/push_parser.hpp"
+#include "detail/parser.hpp"
+#include "detail/validator.hpp"
+#include "detail/view.hpp"
+#include "detail/path.hpp"
+#include "detail/typed.hpp"
+#include "detail/document.hpp"
+#include "detail/parallel.hpp"
+#include "detail/batch.hpp"
+#include "detail/parallel_decoder.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#define TNETSTRING_MAPPED_FILES
+#include "detail/mapped_reader.hpp"
+#include "detail/frame_index.hpp"
+#endif
 #include "detail/operators.hpp"
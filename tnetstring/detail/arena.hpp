@@ -0,0 +1,268 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+
+namespace tnetstring {
+
+/**
+ * Monotonic arena.
+ * Hands out memory from a chain of growing blocks, individual allocations are
+ * never freed. All the memory is released at once by release() or the DTOR.
+ */
+class Arena {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param block_size size of the first block, later blocks double in size
+	 */
+	explicit Arena(std::size_t block_size = 4096)
+		: blocks_(nullptr), pos_(nullptr), end_(nullptr), block_size_(block_size) {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/** DTOR */
+	virtual ~Arena() {
+		free_blocks();
+	}
+
+	/**
+	 * Allocates size bytes aligned to alignment
+	 *
+	 * @throw std::bad_alloc
+	 */
+	void* allocate(std::size_t size, std::size_t alignment) {
+		std::uintptr_t pos = (reinterpret_cast<std::uintptr_t>(pos_) + alignment - 1) & ~(alignment - 1);
+		if (pos_ == nullptr || pos + size > reinterpret_cast<std::uintptr_t>(end_)) {
+			add_block(size + alignment);
+			pos = (reinterpret_cast<std::uintptr_t>(pos_) + alignment - 1) & ~(alignment - 1);
+		}
+		pos_ = reinterpret_cast<char*>(pos + size);
+		return reinterpret_cast<void*>(pos);
+	}
+
+	/**
+	 * Releases all the allocations at once, values allocated from the arena must
+	 * not be used afterwards. The memory is kept for reuse, multiple blocks are
+	 * merged into a single one holding their total size.
+	 */
+	void release() {
+		if (blocks_ == nullptr) {
+			return;
+		}
+		if (blocks_->next != nullptr) {
+			const std::size_t size = capacity();
+			free_blocks();
+			block_size_ = size;
+			add_block(size);
+		}
+		pos_ = reinterpret_cast<char*>(blocks_ + 1);
+	}
+
+	/** Count of bytes held in blocks */
+	std::size_t capacity() const {
+		std::size_t capacity = 0;
+		for (const Block* block = blocks_; block != nullptr; block = block->next) {
+			capacity += block->size;
+		}
+		return capacity;
+	}
+
+private:
+
+	/** Header of a block, the usable memory follows */
+	struct Block {
+		Block* next;
+		std::size_t size;
+	};
+
+	/** Most recent (and largest) block, chained to the older ones */
+	Block* blocks_;
+
+	/** Next free byte of the most recent block */
+	char* pos_;
+
+	/** End of the most recent block */
+	char* end_;
+
+	/** Size of the next block */
+	std::size_t block_size_;
+
+	/** Frees all the blocks */
+	void free_blocks() {
+		while (blocks_ != nullptr) {
+			Block* next = blocks_->next;
+			::operator delete(blocks_);
+			blocks_ = next;
+		}
+		pos_ = end_ = nullptr;
+	}
+
+	/** Adds a block of at least min_size usable bytes */
+	void add_block(std::size_t min_size) {
+		std::size_t size = block_size_;
+		while (size < min_size) {
+			size *= 2;
+		}
+		block_size_ = size * 2;
+
+		Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+		block->next = blocks_;
+		block->size = size;
+		blocks_ = block;
+		pos_ = reinterpret_cast<char*>(block + 1);
+		end_ = pos_ + size;
+	}
+};
+
+/**
+ * Standard allocator handing out memory of an Arena, deallocation is a no-op.
+ */
+template <typename T>
+class Arena_allocator {
+public:
+	typedef T value_type;
+
+	/** CTOR */
+	Arena_allocator(Arena& arena) noexcept : arena_(&arena) {}
+
+	/** CTOR */
+	template <typename U>
+	Arena_allocator(const Arena_allocator<U>& other) noexcept : arena_(other.arena()) {}
+
+	/** Allocates memory for n objects */
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	/** Memory is released with the arena */
+	void deallocate(T*, std::size_t) noexcept {}
+
+	/** Arena the memory is allocated from */
+	Arena* arena() const noexcept {
+		return arena_;
+	}
+
+private:
+	/** Arena the memory is allocated from */
+	Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const Arena_allocator<T>& a, const Arena_allocator<U>& b) noexcept {
+	return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const Arena_allocator<T>& a, const Arena_allocator<U>& b) noexcept {
+	return a.arena() != b.arena();
+}
+
+/**
+ * String allocated from an Arena
+ */
+typedef std::basic_string<char, std::char_traits<char>, Arena_allocator<char> > Arena_string;
+
+class Arena_value;
+
+/**
+ * TNetstring list allocated from an Arena
+ */
+typedef std::vector<Arena_value, Arena_allocator<Arena_value> > Arena_list;
+
+/**
+ * TNetstring dictionary allocated from an Arena
+ */
+typedef std::map<Arena_string, Arena_value, std::less<Arena_string>,
+                 Arena_allocator<std::pair<const Arena_string, Arena_value> > > Arena_dict;
+
+/**
+ * Variant base of Arena_value
+ */
+typedef boost::variant<
+	const char*
+	, int
+	, std::int64_t
+	, std::uint64_t
+	, Arena_string
+	, double
+	, bool
+	, Arena_list
+	, Arena_dict
+> Arena_variant;
+
+/**
+ * TNetstring value allocated from an Arena, holds the same types as TNetstring_value.
+ * The arena has to outlive the value.
+ *
+ * Unlike TNetstring_value, which is a boost::make_recursive_variant and boxes
+ * every list and dict on the global heap, the recursion is resolved by deriving
+ * from the variant, so lists and dicts are held in place.
+ */
+class Arena_value : public Arena_variant {
+public:
+	using Arena_variant::Arena_variant;
+	using Arena_variant::operator=;
+
+	/** CTOR */
+	Arena_value() : Arena_variant() {}
+};
+
+/**
+ * Decoded tree allocated from an Arena, see Heap_tree
+ */
+class Arena_tree {
+public:
+	typedef Arena_value value_type;
+	typedef Arena_string string_type;
+	typedef Arena_list list_type;
+	typedef Arena_dict dict_type;
+	typedef Arena_string key_type;
+
+	/** CTOR */
+	Arena_tree(Arena& arena) : arena_(&arena) {}
+
+	/** New string payload */
+	string_type string(const char* data, std::size_t size) const {
+		return string_type(data, size, Arena_allocator<char>(*arena_));
+	}
+
+	/** New empty list */
+	list_type list() const {
+		return list_type(Arena_allocator<Arena_value>(*arena_));
+	}
+
+	/** New dict key */
+	key_type key(const char* data, std::size_t size) const {
+		return key_type(data, size, Arena_allocator<char>(*arena_));
+	}
+
+	/** New empty dict, see Heap_tree */
+	dict_type dict(std::size_t /* payload_size */ = 0) const {
+		return dict_type(std::less<Arena_string>(), dict_type::allocator_type(*arena_));
+	}
+
+private:
+	/** Arena the tree is allocated from */
+	Arena* arena_;
+};
+
+} // ::tnetstring
@@ -0,0 +1,191 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace tnetstring {
+
+/**
+ * Result of decode_all() and split_all()
+ */
+struct Batch_result {
+	/** Count of complete TNetstrings */
+	std::size_t count;
+
+	/** Count of bytes of the complete TNetstrings */
+	std::size_t consumed;
+
+	/** Count of trailing bytes of an incomplete TNetstring, to be completed by the next piece of data */
+	std::size_t incomplete;
+};
+
+/**
+ * Size of the complete top-level TNetstring at pos
+ *
+ * @throw tnetstring::Parse_exception if the size field is malformed
+ * @return size of the TNetstring, 0 if it is incomplete
+ */
+inline std::size_t complete_frame_size(const char* pos, const char* end) {
+	std::size_t size;
+	const std::size_t size_length = parse_size(pos, end, size);
+
+	if (size_length == 0) {
+		// a size field cut by the end of the data is merely incomplete
+		const std::size_t available = end - pos;
+		if (available <= static_cast<std::size_t>(TNETSTRING_SIZE_MAXLEN) && leading_digits(pos, end) == available) {
+			return 0;
+		}
+		throw_size_exception(pos, end);
+	}
+
+	const std::size_t frame_size = size_length + 1 + size + 1;
+	return frame_size <= static_cast<std::size_t>(end - pos) ? frame_size : 0;
+}
+
+/**
+ * Decodes all the complete back-to-back TNetstrings of the buffer, e.g. of a replay file.
+ * A trailing incomplete TNetstring is left for the next call.
+ *
+ * @throw tnetstring::Parse_exception, tagged with the Offset_info of the failing TNetstring,
+ *        values keeps the TNetstrings decoded before it
+ * @param values the decoded TNetstring_values are appended to
+ * @param int_mode type integers are decoded to
+ */
+inline Batch_result decode_all(const char* data, std::size_t size, std::vector<TNetstring_value>& values,
+                               Int_mode int_mode = INT_NARROWEST) {
+	Batch_result result = {0, 0, 0};
+	const char* pos = data;
+	const char* end = data + size;
+
+	try {
+
+		while (pos != end) {
+			const std::size_t frame_size = complete_frame_size(pos, end);
+			if (frame_size == 0) {
+				break;
+			}
+			Buffer_decoder decoder(pos, frame_size, int_mode);
+			values.emplace_back();
+			try {
+				decoder.decode(values.back());
+			} catch (...) {
+				// drop the partially decoded value
+				values.pop_back();
+				throw;
+			}
+			pos += frame_size;
+			result.count++;
+		}
+
+	} catch (boost::exception& e) {
+		e << Offset_info(pos - data);
+		throw;
+	}
+
+	result.consumed = pos - data;
+	result.incomplete = end - pos;
+	return result;
+}
+
+/**
+ * Decodes all the complete back-to-back TNetstrings of the buffer in parallel, see decode_all().
+ * The TNetstrings are located by a sequential scan of their size fields first, then
+ * decoded on up to threads threads straight into their slots of values.
+ *
+ * @throw tnetstring::Parse_exception, tagged with the Offset_info of the failing TNetstring,
+ *        values is left unchanged
+ * @param values the decoded TNetstring_values are appended to, in the order of the buffer
+ * @param threads count of threads, the calling thread included
+ * @param int_mode type integers are decoded to
+ */
+inline Batch_result decode_all_parallel(const char* data, std::size_t size, std::vector<TNetstring_value>& values,
+                                        unsigned threads = default_thread_count(), Int_mode int_mode = INT_NARROWEST) {
+	Batch_result result = {0, 0, 0};
+	const char* pos = data;
+	const char* end = data + size;
+
+	// offsets of the TNetstrings and of the end of the last one
+	std::vector<std::size_t> offsets(1, 0);
+	try {
+
+		while (pos != end) {
+			const std::size_t frame_size = complete_frame_size(pos, end);
+			if (frame_size == 0) {
+				break;
+			}
+			pos += frame_size;
+			offsets.push_back(pos - data);
+		}
+
+	} catch (boost::exception& e) {
+		e << Offset_info(pos - data);
+		throw;
+	}
+
+	result.count = offsets.size() - 1;
+	result.consumed = pos - data;
+	result.incomplete = end - pos;
+
+	const std::size_t first = values.size();
+	values.resize(first + result.count);
+	try {
+
+		parallel_for(result.count, threads, [&](std::size_t i) {
+			try {
+				Buffer_decoder decoder(data + offsets[i], offsets[i + 1] - offsets[i], int_mode);
+				decoder.decode(values[first + i]);
+			} catch (boost::exception& e) {
+				e << Offset_info(offsets[i]);
+				throw;
+			}
+		});
+
+	} catch (...) {
+		values.resize(first);
+		throw;
+	}
+	return result;
+}
+
+/**
+ * Splits the buffer into Views of all the complete back-to-back TNetstrings, without decoding them.
+ * Only the size fields and types are checked. A trailing incomplete TNetstring is left for the next call.
+ *
+ * @throw tnetstring::Parse_exception, tagged with the Offset_info of the failing TNetstring
+ * @param views the Views are appended to, valid as long as the buffer
+ */
+inline Batch_result split_all(const char* data, std::size_t size, std::vector<View>& views) {
+	Batch_result result = {0, 0, 0};
+	const char* pos = data;
+	const char* end = data + size;
+
+	try {
+
+		while (pos != end) {
+			const std::size_t frame_size = complete_frame_size(pos, end);
+			if (frame_size == 0) {
+				break;
+			}
+			views.emplace_back(pos, frame_size);
+			pos += frame_size;
+			result.count++;
+		}
+
+	} catch (boost::exception& e) {
+		e << Offset_info(pos - data);
+		throw;
+	}
+
+	result.consumed = pos - data;
+	result.incomplete = end - pos;
+	return result;
+}
+
+} // ::tnetstring
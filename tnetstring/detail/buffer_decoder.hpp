@@ -0,0 +1,374 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef GTEST
+#include <gtest/gtest_prod.h>
+#endif
+
+
+namespace tnetstring {
+
+/**
+ * Buffer decoder.
+ * Decodes TNetstrings from a contiguous memory buffer instead of a std::istream.
+ * The buffer is scanned strictly forward, the decoder keeps a cursor which
+ * is advanced by every successfully decoded TNetstring.
+ *
+ * Tree selects the decoded types and where they are allocated, see Heap_tree, Arena_tree,
+ * Hash_tree and Flat_tree.
+ * The buffer is not copied, it has to outlive the decoder.
+ */
+template <typename Tree>
+class Basic_buffer_decoder {
+public:
+	typedef typename Tree::value_type value_type;
+	typedef typename Tree::string_type string_type;
+	typedef typename Tree::list_type list_type;
+	typedef typename Tree::dict_type dict_type;
+	typedef typename Tree::key_type key_type;
+
+	/**
+	 * CTOR
+	 *
+	 * @param data buffer to decode from
+	 * @param size size of the buffer
+	 * @param int_mode type integers are decoded to
+	 * @param tree allocates the decoded values
+	 */
+	Basic_buffer_decoder(const char* data, std::size_t size, Int_mode int_mode = INT_NARROWEST,
+	                     const Tree& tree = Tree())
+		: begin_(data), pos_(data), end_(data + size), int_mode_(int_mode), tree_(tree),
+		  current_size_(0), current_size_digits_(0), current_type_('\0') {};
+
+	/** CTOR */
+	explicit Basic_buffer_decoder(const std::string& data, Int_mode int_mode = INT_NARROWEST,
+	                              const Tree& tree = Tree())
+		: Basic_buffer_decoder(data.data(), data.size(), int_mode, tree) {};
+
+	/** The decoder keeps pointing into data, temporaries would be gone before decoding */
+	explicit Basic_buffer_decoder(const std::string&& data, Int_mode int_mode = INT_NARROWEST,
+	                              const Tree& tree = Tree()) = delete;
+
+	/** DTOR */
+	virtual ~Basic_buffer_decoder() {};
+
+	/**
+	 * Decodes the netstring at the cursor into the given value future.
+	 * Containers are decoded in place, so on failure value holds the part decoded so far.
+	 *
+	 * @throw tnetstring::Parse_exception, value is then left partially decoded,
+	 *        decode into a temporary to keep the previous value
+	 * @param value future decoded value
+	 * @return count of bytes consumed from the buffer
+	 */
+	std::size_t decode(value_type& value) {
+		const char* start = pos_;
+		decode_size();
+		decode_type();
+		decode_value(value);
+		return pos_ - start;
+	}
+
+	/** Offset of the cursor from the beginning of the buffer */
+	std::size_t position() const {
+		return pos_ - begin_;
+	}
+
+	/** Count of bytes not yet consumed */
+	std::size_t remaining() const {
+		return end_ - pos_;
+	}
+
+private:
+
+	/** Beginning of the buffer */
+	const char* begin_;
+
+	/** Cursor, all the methods read from here */
+	const char* pos_;
+
+	/** End of the buffer (one past the last character) */
+	const char* end_;
+
+	/** Type integers are decoded to */
+	Int_mode int_mode_;
+
+	/** Allocates the decoded values */
+	Tree tree_;
+
+	/** Holds the last successfully parsed payload size value */
+	int current_size_;
+
+	/** Holds the last successfully parsed payload size digit count */
+	int current_size_digits_;
+
+	/** Holds the last successfully parsed payload type character */
+	char current_type_;
+
+	/**
+	 * Decodes the next size field with a single forward scan.
+	 * Successfully parsed size data including the delimiter will be consumed.
+	 * Well formed size fields are converted up to eight digits at once.
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	void decode_size() {
+		std::size_t size;
+		const std::size_t size_length = parse_size(pos_, end_, size);
+
+		if (size_length == 0) {
+			throw_size_exception(pos_, end_);
+		}
+
+		// consume the size field including the delimiter
+		pos_ += size_length + 1;
+
+		current_size_ = static_cast<int>(size);
+		current_size_digits_ = static_cast<int>(size_length);
+	}
+#ifdef GTEST
+	FRIEND_TEST(Test_tnetstring_value, Buffer_decoder_decode_size);
+#endif
+
+	/**
+	 * Reads and checks the type character following the current payload
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	void decode_type() {
+		// check for premature end of buffer
+		if (static_cast<std::size_t>(end_ - pos_) <= static_cast<std::size_t>(current_size_)) {
+			Parse_exception e = create_parse_exception("Premature end of TNetstring");
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		const char c = pos_[current_size_];
+
+		// if NOT one of the supported types
+		if (!(c == TNETSTRING_TAG_STRING  || c == TNETSTRING_TAG_INT     ||
+			  c == TNETSTRING_TAG_FLOAT   || c == TNETSTRING_TAG_BOOLEAN ||
+			  c == TNETSTRING_TAG_NULL    || c == TNETSTRING_TAG_DICT    ||
+			  c == TNETSTRING_TAG_LIST))
+		{
+			// -> illegal netstring.
+			Parse_exception e =
+					create_parse_exception("Illegal or unsupported TNetstring payload type");
+			e << Parse_char_info(c);
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		// finally save successfully parsed type
+		current_type_ = c;
+	}
+
+	/**
+	 * (Recursively) decodes the payload and the type
+	 * Payload and type character are consumed, the type has to be checked by decode_type().
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param value future decoded value
+	 */
+	void decode_value(value_type& value) {
+
+		const char* payload = pos_;
+		const int payload_size = current_size_;
+
+		switch (current_type_) {
+			case TNETSTRING_TAG_STRING: {
+				value = tree_.string(payload, payload_size);
+			}; break;
+
+			case TNETSTRING_TAG_INT: {
+				if (!parse_integer(payload, payload_size, int_mode_, value)) {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int");
+					e << Parse_value_info(std::string(payload, payload_size));
+					BOOST_THROW_EXCEPTION(e);
+				}
+			}; break;
+
+			case TNETSTRING_TAG_FLOAT: {
+				double double_val;
+				if (!parse_double(payload, payload_size, double_val)) {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to double");
+					e << Parse_value_info(std::string(payload, payload_size));
+					BOOST_THROW_EXCEPTION(e);
+				}
+				value = double_val;
+			}; break;
+
+			case TNETSTRING_TAG_BOOLEAN: {
+				value = (payload_size == 4 && std::memcmp(payload, "true", 4) == 0);
+			}; break;
+
+			case TNETSTRING_TAG_NULL: {
+				value = nullptr;
+			}; break;
+
+			case TNETSTRING_TAG_DICT: {
+				// construct the dict inside the variant and decode in place
+				value = tree_.dict(payload_size);
+				decode_dict(boost::get<dict_type>(value));
+			}; break;
+
+			case TNETSTRING_TAG_LIST: {
+				// construct the list inside the variant and decode in place
+				value = tree_.list();
+				decode_list(boost::get<list_type>(value));
+			}; break;
+
+			default:
+				// -> unsupported type
+				Parse_exception e = create_parse_exception("payload type not implemented");
+				e << Parse_char_info(current_type_);
+				BOOST_THROW_EXCEPTION(e);
+		}
+
+		// consume payload and type character
+		pos_ = payload + payload_size + 1;
+	}
+
+	/**
+	 * Decodes the next element of a container and checks it fits into the container
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param value future decoded value
+	 * @param container_end end of the payload of the enclosing container
+	 */
+	void decode_element(value_type& value, const char* container_end) {
+		decode_size();
+
+		if (container_end - pos_ <= current_size_) {
+			Parse_exception e =
+					create_parse_exception("TNetstring element exceeds its container");
+			e << Size_info(current_size_);
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		decode_type();
+		decode_value(value);
+	}
+
+	/**
+	 * Decodes the next dict key, which has to be a string, and checks it fits into the dict
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param container_end end of the payload of the dict
+	 */
+	key_type decode_key(const char* container_end) {
+		decode_size();
+
+		if (container_end - pos_ <= current_size_) {
+			Parse_exception e =
+					create_parse_exception("TNetstring element exceeds its container");
+			e << Size_info(current_size_);
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		decode_type();
+
+		// only strings are allowed as key
+		if (current_type_ != TNETSTRING_TAG_STRING) {
+			Parse_exception e = create_parse_exception("dict key must be of type string");
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		key_type key = tree_.key(pos_, current_size_);
+		pos_ += current_size_ + 1;
+		return key;
+	}
+
+	/**
+	 * (Recursively) decodes the current payload into a list
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param list future decoded list
+	 */
+	void decode_list(list_type& list) {
+
+		const char* container_end = pos_ + current_size_;
+
+		try {
+
+			while (pos_ < container_end) {
+				list.emplace_back();
+				decode_element(list.back(), container_end);
+			}
+
+		} catch (boost::exception& e) {
+			e << Count_info(container_end - pos_);
+			throw;
+		}
+	}
+
+	/**
+	 * (Recursively) decodes the current payload into a dict
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param dict future decoded dict
+	 */
+	void decode_dict(dict_type& dict) {
+
+		const char* container_end = pos_ + current_size_;
+
+		try {
+
+			while (pos_ < container_end) {
+				// KEY
+				key_type key = decode_key(container_end);
+
+				// VALUE, decoded in place, a duplicate key keeps the first value
+				std::pair<typename dict_type::iterator, bool> inserted =
+						dict.emplace(std::move(key), value_type());
+				if (inserted.second) {
+					decode_element(inserted.first->second, container_end);
+				} else {
+					value_type duplicate_value;
+					decode_element(duplicate_value, container_end);
+				}
+			}
+
+		} catch (boost::exception& e) {
+			e << Count_info(container_end - pos_);
+			throw;
+		}
+	}
+
+};
+
+/**
+ * Buffer decoder building TNetstring_values on the global heap
+ */
+typedef Basic_buffer_decoder<Heap_tree> Buffer_decoder;
+
+/**
+ * Buffer decoder building Arena_values in an Arena
+ */
+typedef Basic_buffer_decoder<Arena_tree> Arena_decoder;
+
+/**
+ * Buffer decoder building Hash_values, with hash dicts
+ */
+typedef Basic_buffer_decoder<Hash_tree> Hash_decoder;
+
+/**
+ * Buffer decoder building Flat_values, with sorted vector dicts
+ */
+typedef Basic_buffer_decoder<Flat_tree> Flat_decoder;
+
+/**
+ * Buffer decoder building Interned_values, with dict keys interned into a Key_table
+ */
+typedef Basic_buffer_decoder<Interned_tree> Interned_decoder;
+
+} // ::tnetstring
@@ -0,0 +1,246 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/assert.hpp>
+#include <boost/utility/string_view.hpp>
+
+namespace tnetstring {
+
+/**
+ * Result of encode_to()
+ */
+struct Encode_result {
+	/** True if the value was encoded, false if the buffer is too small */
+	bool ok;
+
+	/** Count of bytes written, or the required buffer size if the buffer is too small */
+	std::size_t size;
+};
+
+/**
+ * Buffer encoder.
+ * Encodes TNetstrings into a single buffer in one pass.
+ *
+ * The buffer is filled from the back: every payload is written before its
+ * size field, so the size of a nested list or dict is known by the time
+ * its size field is written and no payload byte has to be copied again.
+ * The buffer is sized once per call with uncut_encoded_size(), as payloads
+ * exceeding TNETSTRING_DATA_MAXLEN are written completely before they are
+ * cut, and kept between calls to encode() for reuse.
+ */
+class Buffer_encoder : public boost::static_visitor<> {
+
+public:
+	/** CTOR */
+	Buffer_encoder() : buffer_(), first_(nullptr), begin_(nullptr), end_(nullptr) {}
+
+	/** DTOR */
+	virtual ~Buffer_encoder() {}
+
+	/**
+	 * Encodes the value, replacing the previously encoded one
+	 *
+	 * @return encoded TNetstring, valid until the next call to encode()
+	 */
+	boost::string_view encode(const TNetstring_value& value) {
+		const std::size_t len = uncut_encoded_size(value);
+		if (buffer_.size() < len) {
+			buffer_.resize(len);
+		}
+		first_ = buffer_.data();
+		begin_ = end_ = first_ + len;
+
+		boost::apply_visitor(*this, value);
+		return boost::string_view(data(), size());
+	}
+
+	/** First byte of the encoded TNetstring */
+	const char* data() const {
+		return begin_;
+	}
+
+	/** Count of bytes of the encoded TNetstring */
+	std::size_t size() const {
+		return end_ - begin_;
+	}
+
+	/** Copy of the encoded TNetstring */
+	std::string str() const {
+		return std::string(data(), size());
+	}
+
+	/** String netstring encoding */
+	void operator()(const std::string& str_val) {
+		prepend_tnetstring(str_val.data(), str_val.size(), TNETSTRING_TAG_STRING);
+	}
+
+	/** Cstring / nullptr netstring encoding */
+	void operator()(const char* cstring_val) {
+		if (cstring_val != nullptr) {
+			prepend_tnetstring(cstring_val, std::strlen(cstring_val), TNETSTRING_TAG_STRING);
+		} else {
+			prepend(TNETSTRING_NULL.data(), TNETSTRING_NULL.size());
+		}
+	}
+
+	/** Integer netstring encoding */
+	void operator()(const int& int_val) {
+		char msg[INT_FORMAT_MAXLEN];
+		prepend_tnetstring(msg, format_int(int_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** 64 bit integer netstring encoding */
+	void operator()(const std::int64_t& int64_val) {
+		char msg[INT64_FORMAT_MAXLEN];
+		prepend_tnetstring(msg, format_int64(int64_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** Unsigned 64 bit integer netstring encoding */
+	void operator()(const std::uint64_t& uint64_val) {
+		char msg[INT64_FORMAT_MAXLEN];
+		prepend_tnetstring(msg, format_uint64(uint64_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** Double netstring encoding */
+	void operator()(const double& double_val) {
+		char msg[DOUBLE_FORMAT_MAXLEN];
+		prepend_tnetstring(msg, format_double(double_val, msg), TNETSTRING_TAG_FLOAT);
+	}
+
+	/** Boolean netstring encoding */
+	void operator()(const bool& bool_val) {
+		if (bool_val) {
+			prepend_tnetstring("true", 4, TNETSTRING_TAG_BOOLEAN);
+		} else {
+			prepend_tnetstring("false", 5, TNETSTRING_TAG_BOOLEAN);
+		}
+	}
+
+	/** List netstring encoding */
+	void operator()(const TNetstring_list& list_val) {
+		prepend(TNETSTRING_TAG_LIST);
+		const char* payload_end = begin_;
+
+		for (TNetstring_list::const_reverse_iterator i = list_val.rbegin(); i != list_val.rend(); ++i) {
+			boost::apply_visitor(*this, *i);
+		}
+
+		prepend_container_size(payload_end - begin_);
+	}
+
+	/** Dict netstring encoding */
+	void operator()(const TNetstring_dict& dict_val) {
+		prepend(TNETSTRING_TAG_DICT);
+		const char* payload_end = begin_;
+
+		for (TNetstring_dict::const_reverse_iterator i = dict_val.rbegin(); i != dict_val.rend(); ++i) {
+			boost::apply_visitor(*this, i->second);
+			prepend_tnetstring(i->first.data(), i->first.size(), TNETSTRING_TAG_STRING);
+		}
+
+		prepend_container_size(payload_end - begin_);
+	}
+
+private:
+	/** Owned output buffer */
+	std::vector<char> buffer_;
+
+	/** First byte of the output buffer */
+	char* first_;
+
+	/** First byte of the encoded TNetstring, moves towards first_ while encoding */
+	char* begin_;
+
+	/** One past the last byte of the encoded TNetstring */
+	char* end_;
+
+	/** CTOR, encodes into the caller's buffer of exactly the encoded size */
+	Buffer_encoder(char* buffer, std::size_t len)
+		: buffer_(), first_(buffer), begin_(buffer + len), end_(buffer + len) {}
+
+	friend Encode_result encode_to(char* buffer, std::size_t capacity, const TNetstring_value& value);
+
+	/** Prepends a single character */
+	void prepend(char c) {
+		BOOST_ASSERT(begin_ > first_);
+		*--begin_ = c;
+	}
+
+	/** Prepends count bytes */
+	void prepend(const char* bytes, std::size_t count) {
+		BOOST_ASSERT(static_cast<std::size_t>(begin_ - first_) >= count);
+		begin_ -= count;
+		std::memcpy(begin_, bytes, count);
+	}
+
+	/** Prepends size digits and the size delimiter */
+	void prepend_size(std::size_t len) {
+		prepend(TNETSTRING_SIZE_DELIM);
+		do {
+			prepend(static_cast<char>('0' + len % 10));
+			len /= 10;
+		} while (len != 0);
+	}
+
+	/** Prepends a complete TNetstring, the payload is cut after TNETSTRING_DATA_MAXLEN */
+	void prepend_tnetstring(const char* msg, std::size_t len, const char tag) {
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+		prepend(tag);
+		prepend(msg, len);
+		prepend_size(len);
+	}
+
+	/**
+	 * Prepends the size field of an already written list or dict payload.
+	 * Payloads exceeding TNETSTRING_DATA_MAXLEN are cut like the stream encoder does.
+	 */
+	void prepend_container_size(std::size_t len) {
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			const std::size_t cut = len - TNETSTRING_DATA_MAXLEN;
+			std::memmove(begin_ + cut, begin_, TNETSTRING_DATA_MAXLEN);
+			begin_ += cut;
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+		prepend_size(len);
+	}
+};
+
+/**
+ * Encodes value into the caller supplied buffer without any heap allocation,
+ * unless a list or dict has to be cut after TNETSTRING_DATA_MAXLEN
+ *
+ * @param buffer output buffer
+ * @param capacity size of the output buffer
+ * @return count of bytes written, or the required size if capacity is too small
+ */
+inline Encode_result encode_to(char* buffer, std::size_t capacity, const TNetstring_value& value) {
+	Encode_result result;
+	result.size = encoded_size(value);
+	result.ok = (result.size <= capacity);
+
+	if (result.ok) {
+		// a cut container makes the outermost value reach the maximum size
+		if (result.size < Size_calculator::tnetstring_size(TNETSTRING_DATA_MAXLEN)) {
+			Buffer_encoder encoder(buffer, result.size);
+			boost::apply_visitor(encoder, value);
+		} else {
+			Buffer_encoder encoder;
+			const boost::string_view encoded = encoder.encode(value);
+			std::memcpy(buffer, encoded.data(), encoded.size());
+		}
+	}
+	return result;
+}
+
+} // ::tnetstring
@@ -6,6 +6,10 @@
 
 #pragma once
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #ifdef GTEST
 #include <gtest/gtest_prod.h>
 #endif
@@ -17,17 +21,25 @@ namespace tnetstring {
 class Decoder {
 public:
 
-	/** CTOR */
-	Decoder(std::istream& in)
-		: in_(in), current_size_(0), current_size_digits_(0), current_type_('\0') {};
+	/**
+	 * CTOR
+	 *
+	 * @param in stream to decode from
+	 * @param int_mode type integers are decoded to
+	 */
+	Decoder(std::istream& in, Int_mode int_mode = INT_NARROWEST)
+		: in_(in), int_mode_(int_mode), current_size_(0), current_size_digits_(0), current_type_('\0'),
+		  dict_ends_(), key_buffer_() {};
 
 	/** DTOR */
 	virtual ~Decoder() {};
 
 	/**
-	 * Decodes the netstring in the stream into the given value future
+	 * Decodes the netstring in the stream into the given value future.
+	 * Containers are decoded in place, so on failure value holds the part decoded so far.
 	 *
-	 * @throw tnetstring::Parse_exception, boost::bad_lexical_cast
+	 * @throw tnetstring::Parse_exception, value is then left partially decoded,
+	 *        decode into a temporary to keep the previous value
 	 * @param value future decoded TNetstring_value
 	 */
 	void decode(TNetstring_value& value){
@@ -36,11 +48,116 @@ public:
 		decode_value(value);
 	}
 
+	/**
+	 * Skips the next TNetstring without decoding it, by its size field alone
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	void skip() {
+		decode_size();
+		decode_type();
+		in_.seekg(current_size_ + 1, std::ios::cur);
+	}
+
+	/**
+	 * Enters the dict at the stream position, see skip_to_key() and leave_dict().
+	 * Dicts may be entered recursively.
+	 *
+	 * @throw tnetstring::Parse_exception, tnetstring::Type_exception if the TNetstring is no dict,
+	 *        the stream is then left unchanged
+	 */
+	void enter_dict() {
+		const std::streampos streampos = in_.tellg();
+		decode_size();
+		decode_type();
+		if (current_type_ != TNETSTRING_TAG_DICT) {
+			in_.seekg(streampos);
+			Type_exception e;
+			e << Error_msg_info("TNetstring value is not a dict");
+			e << Parse_char_info(current_type_);
+			BOOST_THROW_EXCEPTION(e);
+		}
+		dict_ends_.push_back(in_.tellg() + std::streamoff(current_size_));
+	}
+
+	/**
+	 * Advances to the value of key in the entered dict, skipping the keys and values in
+	 * between by their size fields. Keys are searched from the stream position onwards,
+	 * so fields are best looked up in the order they were encoded.
+	 * The value is then read by decode(), skip() or enter_dict().
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return false if the dict has no more such key, it is then left
+	 */
+	bool skip_to_key(const std::string& key) {
+		if (dict_ends_.empty()) {
+			Type_exception e;
+			e << Error_msg_info("No dict entered");
+			BOOST_THROW_EXCEPTION(e);
+		}
+		const std::streampos dict_end = dict_ends_.back();
+
+		while (in_.tellg() < dict_end) {
+			// KEY
+			decode_size();
+			decode_type();
+			if (current_type_ != TNETSTRING_TAG_STRING) {
+				Parse_exception e = create_parse_exception("dict key must be of type string");
+				BOOST_THROW_EXCEPTION(e);
+			}
+			bool match = false;
+			if (static_cast<std::size_t>(current_size_) == key.size()) {
+				key_buffer_.resize(key.size());
+				in_.read(&key_buffer_[0], key.size());
+				in_.ignore(1);
+				match = key_buffer_ == key;
+			} else {
+				in_.seekg(current_size_ + 1, std::ios::cur);
+			}
+			if (in_.tellg() >= dict_end) {
+				Parse_exception e = create_parse_exception("Premature end of TNetstring");
+				BOOST_THROW_EXCEPTION(e);
+			}
+
+			// VALUE
+			if (match) {
+				return true;
+			}
+			skip();
+		}
+
+		if (in_.tellg() > dict_end) {
+			Parse_exception e = create_parse_exception("TNetstring element exceeds its container");
+			BOOST_THROW_EXCEPTION(e);
+		}
+		leave_dict();
+		return false;
+	}
+
+	/**
+	 * Skips the rest of the entered dict
+	 *
+	 * @throw tnetstring::Type_exception if no dict is entered
+	 */
+	void leave_dict() {
+		if (dict_ends_.empty()) {
+			Type_exception e;
+			e << Error_msg_info("No dict entered");
+			BOOST_THROW_EXCEPTION(e);
+		}
+		// discard the rest of the payload and the type character
+		in_.seekg(dict_ends_.back() + std::streamoff(1));
+		dict_ends_.pop_back();
+	}
+
 private:
 
 	/** The input stream all the methods read from */
 	std::istream& in_;
 
+	/** Type integers are decoded to */
+	Int_mode int_mode_;
+
 	/** Holds the last successfully parsed payload size value */
 	int current_size_;
 
@@ -50,15 +167,22 @@ private:
 	/** Holds the last successfully parsed payload type character */
 	char current_type_;
 
+	/** Stream positions of the ends of the entered dict payloads */
+	std::vector<std::streampos> dict_ends_;
+
+	/** Keys compared by skip_to_key() */
+	std::string key_buffer_;
+
 	/**
 	 * Decodes the next size field
 	 * Successfully parsed size data will be streamed off the stream.
 	 *
-	 * @throw tnetstring::Parse_exception, boost::bad_lexical_cast
+	 * @throw tnetstring::Parse_exception
 	 */
 	void decode_size() {
-		// length of the size field
+		// length and value of the size field
 		int size_length = 0;
+		int size = 0;
 		char c;
 
 		// save stream pointer position
@@ -103,24 +227,24 @@ private:
 					e << Parse_char_info(c);
 					BOOST_THROW_EXCEPTION(e);
 				}
+
+				// accumulate the digits of the size
+				size = size * 10 + (c - '0');
 			}
 		}
 
-		// stream the size field
-		in_.width(size_length);
-		std::string size_str;
-		in_ >> size_str;
+		// an empty size field is no integer
+		if (size_length == 0) {
+			Parse_exception e = create_parse_exception("TNetstring size field is not an integer.");
+			e << Parse_pos_info(size_length);
+			BOOST_THROW_EXCEPTION(e);
+		}
 
 		// extract and discard the size field including the delimiter
-		in_.ignore(1);
+		in_.ignore(size_length + 1);
 
-		// convert to int and save successfully parsed size and digits to class members
-		try {
-			current_size_ = boost::lexical_cast<int>(size_str);
-		} catch (boost::exception& e) {
-			e << Error_msg_info("TNetstring size field is not an integer.");
-			throw;
-		}
+		// save successfully parsed size and digits to class members
+		current_size_ = size;
 		current_size_digits_ = size_length;
 	}
 #ifdef GTEST
@@ -203,30 +327,28 @@ private:
 			BOOST_THROW_EXCEPTION(e);
 		}
 
-		// lexical casting to native type
+		// parsing to native type
 		switch (current_type) {
 			case TNETSTRING_TAG_STRING: {
-				value = payload_str;
+				value = std::move(payload_str);
 			}; break;
 
 			case TNETSTRING_TAG_INT: {
-				try {
-					value = boost::lexical_cast<int>(payload_str);
-				} catch (boost::exception& e) {
-					e << Error_msg_info("TNetstring payload cannot be casted to int");
+				if (!parse_integer(payload_str.data(), payload_str.size(), int_mode_, value)) {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int");
 					e << Parse_value_info(payload_str);
-					throw;
+					BOOST_THROW_EXCEPTION(e);
 				}
 			}; break;
 
 			case TNETSTRING_TAG_FLOAT: {
-				try {
-					value = boost::lexical_cast<double>(payload_str);
-				} catch (boost::exception& e) {
-					e << Error_msg_info("TNetstring payload cannot be casted to double");
+				double double_val;
+				if (!parse_double(payload_str.data(), payload_str.size(), double_val)) {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to double");
 					e << Parse_value_info(payload_str);
-					throw;
+					BOOST_THROW_EXCEPTION(e);
 				}
+				value = double_val;
 			}; break;
 
 			case TNETSTRING_TAG_BOOLEAN: {
@@ -242,15 +364,15 @@ private:
 			}; break;
 
 			case TNETSTRING_TAG_DICT: {
-				TNetstring_dict dict;
-				decode_dict(dict);
-				value = dict;  // copy dict into variant
+				// construct the dict inside the variant and decode in place
+				value = TNetstring_dict();
+				decode_dict(boost::get<TNetstring_dict>(value));
 			}; break;
 
 			case TNETSTRING_TAG_LIST: {
-				TNetstring_list list;
-				decode_list(list);
-				value = list;  // copy list into variant
+				// construct the list inside the variant and decode in place
+				value = TNetstring_list();
+				decode_list(boost::get<TNetstring_list>(value));
 			}; break;
 
 			default:
@@ -286,13 +408,10 @@ private:
 				int current_size = current_size_;
 				int current_size_digits = current_size_digits_;
 
-				// allocate new value which will be added to the list
-				TNetstring_value new_value;
-
-				// (recursively) decode the current value and add the new element to the list
+				// append the new element and (recursively) decode into it
+				list.emplace_back();
 				decode_type();
-				decode_value(new_value);
-				list.push_back(new_value); // add copy to vector
+				decode_value(list.back());
 
 				// count consumed characters and use to calculate the remaining character count
 				remaining_count = remaining_count
@@ -359,18 +478,17 @@ private:
 				int value_current_size = current_size_;
 				int value_current_size_digits = current_size_digits_;
 
-				// allocate new value which will be added to the list
-				TNetstring_value new_value;
-
-				// decode the current value and add the new element to the dict
+				// insert the key and (recursively) decode into its value,
+				// a duplicate key decodes into a scratch value and keeps the first one
 				decode_type();
-				decode_value(new_value);
-
-				// --------------------------------
-
-				// append to dict
-				std::string new_key_str = boost::get<std::string>(new_key);
-				dict.insert( std::make_pair( new_key_str , new_value ));  // add copies to map
+				std::pair<TNetstring_dict::iterator, bool> inserted =
+						dict.emplace(std::move(boost::get<std::string>(new_key)), TNetstring_value());
+				if (inserted.second) {
+					decode_value(inserted.first->second);
+				} else {
+					TNetstring_value duplicate_value;
+					decode_value(duplicate_value);
+				}
 
 				// count consumed characters and use to calculate the remaining character count
 				remaining_count = remaining_count
@@ -394,16 +512,6 @@ private:
 	FRIEND_TEST(Test_tnetstring_value, Decoder_decode_dict);
 #endif
 
-	/**
-	 * Utility methode to create new exceptions and fill them with
-	 * default error_info data.
-	 */
-	tnetstring::Parse_exception create_parse_exception(const std::string& error_msg) {
-		Parse_exception e = Parse_exception();
-		e << Error_msg_info(error_msg);
-		return e;
-	}
-
 };
 
 
@@ -0,0 +1,412 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+#include <boost/variant.hpp>
+
+
+namespace tnetstring {
+
+/** Encoded bytes per dict element assumed to estimate the element count of a dict payload */
+const std::size_t DICT_ELEMENT_SIZE_ESTIMATE = 16;
+
+/** Maximum count of elements reserved from an estimate, larger dicts grow as they are decoded */
+const std::size_t DICT_RESERVE_MAX = 1024;
+
+/**
+ * Element count estimated from the payload size of a dict
+ */
+inline std::size_t estimate_dict_size(std::size_t payload_size) {
+	return std::min(payload_size / DICT_ELEMENT_SIZE_ESTIMATE, DICT_RESERVE_MAX);
+}
+
+/**
+ * FNV-1a hash of a string key
+ */
+inline std::size_t hash_key(boost::string_view key) {
+	std::uint64_t hash = 14695981039346656037ull;
+	for (const char c : key) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+/**
+ * Key traits of dicts with std::string keys, looked up by boost::string_view
+ */
+struct String_key_traits {
+	typedef std::string key_type;
+	typedef boost::string_view lookup_type;
+
+	static std::size_t hash(lookup_type key) {
+		return hash_key(key);
+	}
+};
+
+/**
+ * Open addressing hash dict.
+ * The elements are held in a vector in insertion order, a power of two sized
+ * table of element indices is probed linearly and kept at most half full.
+ * Elements are never erased, as decoded dicts only grow.
+ *
+ * Traits define the key type, the type keys are looked up by and their hash.
+ */
+template <typename Value, typename Traits = String_key_traits>
+class Basic_hash_dict {
+public:
+	typedef typename Traits::key_type key_type;
+	typedef typename Traits::lookup_type lookup_type;
+	typedef Value mapped_type;
+	typedef std::pair<key_type, Value> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+	/** CTOR */
+	Basic_hash_dict() : elements_(), slots_() {};
+
+	/** Reserves room for count elements */
+	void reserve(std::size_t count) {
+		elements_.reserve(count);
+		if (2 * count > slots_.size()) {
+			rehash(table_size(count));
+		}
+	}
+
+	/**
+	 * Inserts key with value unless key exists
+	 *
+	 * @return the element of key and whether it was inserted
+	 */
+	std::pair<iterator, bool> emplace(key_type key, Value value) {
+		if (2 * (elements_.size() + 1) > slots_.size()) {
+			rehash(table_size(elements_.size() + 1));
+		}
+		std::size_t slot = probe(key);
+		if (slots_[slot] != 0) {
+			return std::make_pair(elements_.begin() + (slots_[slot] - 1), false);
+		}
+		elements_.emplace_back(std::move(key), std::move(value));
+		slots_[slot] = static_cast<std::uint32_t>(elements_.size());
+		return std::make_pair(elements_.end() - 1, true);
+	}
+
+	/** Element of key or end() */
+	iterator find(lookup_type key) {
+		if (slots_.empty()) {
+			return elements_.end();
+		}
+		const std::uint32_t index = slots_[probe(key)];
+		return index != 0 ? elements_.begin() + (index - 1) : elements_.end();
+	}
+
+	/** Element of key or end() */
+	const_iterator find(lookup_type key) const {
+		return const_cast<Basic_hash_dict*>(this)->find(key);
+	}
+
+	/**
+	 * Value of key
+	 *
+	 * @throw std::out_of_range
+	 */
+	const Value& at(lookup_type key) const {
+		const_iterator it = find(key);
+		if (it == end()) {
+			throw std::out_of_range("Basic_hash_dict::at");
+		}
+		return it->second;
+	}
+
+	std::size_t count(lookup_type key) const { return find(key) != end() ? 1 : 0; }
+	std::size_t size() const { return elements_.size(); }
+	bool empty() const { return elements_.empty(); }
+	iterator begin() { return elements_.begin(); }
+	iterator end() { return elements_.end(); }
+	const_iterator begin() const { return elements_.begin(); }
+	const_iterator end() const { return elements_.end(); }
+
+private:
+
+	/** Elements in insertion order */
+	std::vector<value_type> elements_;
+
+	/** Element index + 1 per slot, 0 for empty slots */
+	std::vector<std::uint32_t> slots_;
+
+	/** Smallest power of two table holding count elements at most half full */
+	static std::size_t table_size(std::size_t count) {
+		std::size_t size = 8;
+		while (size < 2 * count) {
+			size *= 2;
+		}
+		return size;
+	}
+
+	/** Slot of key, or the empty slot it would be inserted into */
+	std::size_t probe(lookup_type key) const {
+		const std::size_t mask = slots_.size() - 1;
+		std::size_t slot = Traits::hash(key) & mask;
+		while (slots_[slot] != 0 && elements_[slots_[slot] - 1].first != key) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	/** Rebuilds the table with size slots */
+	void rehash(std::size_t size) {
+		slots_.assign(size, 0);
+		for (std::size_t i = 0; i < elements_.size(); i++) {
+			slots_[probe(elements_[i].first)] = static_cast<std::uint32_t>(i + 1);
+		}
+	}
+
+};
+
+/**
+ * Flat dict.
+ * The elements are held in a vector sorted by key and looked up by binary search,
+ * best for small dicts. Keys arriving in ascending order, like those encoded from
+ * a TNetstring_dict, are appended without moving elements.
+ */
+template <typename Value>
+class Basic_flat_dict {
+public:
+	typedef std::string key_type;
+	typedef Value mapped_type;
+	typedef std::pair<std::string, Value> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+	/** CTOR */
+	Basic_flat_dict() : elements_() {};
+
+	/** Reserves room for count elements */
+	void reserve(std::size_t count) {
+		elements_.reserve(count);
+	}
+
+	/**
+	 * Inserts key with value unless key exists
+	 *
+	 * @return the element of key and whether it was inserted
+	 */
+	std::pair<iterator, bool> emplace(std::string key, Value value) {
+		if (elements_.empty() || elements_.back().first < key) {
+			elements_.emplace_back(std::move(key), std::move(value));
+			return std::make_pair(elements_.end() - 1, true);
+		}
+		iterator it = lower_bound(key);
+		if (it->first == key) {
+			return std::make_pair(it, false);
+		}
+		return std::make_pair(elements_.emplace(it, std::move(key), std::move(value)), true);
+	}
+
+	/** Element of key or end() */
+	iterator find(boost::string_view key) {
+		iterator it = lower_bound(key);
+		return (it != elements_.end() && it->first == key) ? it : elements_.end();
+	}
+
+	/** Element of key or end() */
+	const_iterator find(boost::string_view key) const {
+		return const_cast<Basic_flat_dict*>(this)->find(key);
+	}
+
+	/**
+	 * Value of key
+	 *
+	 * @throw std::out_of_range
+	 */
+	const Value& at(boost::string_view key) const {
+		const_iterator it = find(key);
+		if (it == end()) {
+			throw std::out_of_range("Basic_flat_dict::at");
+		}
+		return it->second;
+	}
+
+	std::size_t count(boost::string_view key) const { return find(key) != end() ? 1 : 0; }
+	std::size_t size() const { return elements_.size(); }
+	bool empty() const { return elements_.empty(); }
+	iterator begin() { return elements_.begin(); }
+	iterator end() { return elements_.end(); }
+	const_iterator begin() const { return elements_.begin(); }
+	const_iterator end() const { return elements_.end(); }
+
+private:
+
+	/** Elements sorted by key */
+	std::vector<value_type> elements_;
+
+	/** First element with a key not less than key */
+	iterator lower_bound(boost::string_view key) {
+		return std::lower_bound(elements_.begin(), elements_.end(), key,
+				[](const value_type& element, boost::string_view key) {
+					return boost::string_view(element.first) < key;
+				});
+	}
+
+};
+
+class Hash_value;
+class Flat_value;
+
+/**
+ * TNetstring list of Hash_values
+ */
+typedef std::vector<Hash_value> Hash_list;
+
+/**
+ * TNetstring dictionary hashing its keys
+ */
+typedef Basic_hash_dict<Hash_value> Hash_dict;
+
+/**
+ * TNetstring list of Flat_values
+ */
+typedef std::vector<Flat_value> Flat_list;
+
+/**
+ * TNetstring dictionary sorted in a vector
+ */
+typedef Basic_flat_dict<Flat_value> Flat_dict;
+
+/**
+ * Variant base of Hash_value
+ */
+typedef boost::variant<
+	const char*
+	, int
+	, std::int64_t
+	, std::uint64_t
+	, std::string
+	, double
+	, bool
+	, Hash_list
+	, Hash_dict
+> Hash_variant;
+
+/**
+ * Variant base of Flat_value
+ */
+typedef boost::variant<
+	const char*
+	, int
+	, std::int64_t
+	, std::uint64_t
+	, std::string
+	, double
+	, bool
+	, Flat_list
+	, Flat_dict
+> Flat_variant;
+
+/**
+ * TNetstring value with Hash_dicts, holds the same types as TNetstring_value.
+ * The recursion is resolved by deriving from the variant, see Arena_value.
+ */
+class Hash_value : public Hash_variant {
+public:
+	using Hash_variant::Hash_variant;
+	using Hash_variant::operator=;
+
+	/** CTOR */
+	Hash_value() : Hash_variant() {}
+};
+
+/**
+ * TNetstring value with Flat_dicts, holds the same types as TNetstring_value.
+ * The recursion is resolved by deriving from the variant, see Arena_value.
+ */
+class Flat_value : public Flat_variant {
+public:
+	using Flat_variant::Flat_variant;
+	using Flat_variant::operator=;
+
+	/** CTOR */
+	Flat_value() : Flat_variant() {}
+};
+
+/**
+ * Decoded tree of Hash_values, dicts are reserved from their payload size, see Heap_tree
+ */
+class Hash_tree {
+public:
+	typedef Hash_value value_type;
+	typedef std::string string_type;
+	typedef Hash_list list_type;
+	typedef Hash_dict dict_type;
+	typedef std::string key_type;
+
+	/** New string payload */
+	string_type string(const char* data, std::size_t size) const {
+		return string_type(data, size);
+	}
+
+	/** New empty list */
+	list_type list() const {
+		return list_type();
+	}
+
+	/** New dict key */
+	key_type key(const char* data, std::size_t size) const {
+		return key_type(data, size);
+	}
+
+	/** New empty dict, reserved for the elements estimated from payload_size */
+	dict_type dict(std::size_t payload_size = 0) const {
+		dict_type dict;
+		dict.reserve(estimate_dict_size(payload_size));
+		return dict;
+	}
+};
+
+/**
+ * Decoded tree of Flat_values, dicts are reserved from their payload size, see Heap_tree
+ */
+class Flat_tree {
+public:
+	typedef Flat_value value_type;
+	typedef std::string string_type;
+	typedef Flat_list list_type;
+	typedef Flat_dict dict_type;
+	typedef std::string key_type;
+
+	/** New string payload */
+	string_type string(const char* data, std::size_t size) const {
+		return string_type(data, size);
+	}
+
+	/** New empty list */
+	list_type list() const {
+		return list_type();
+	}
+
+	/** New dict key */
+	key_type key(const char* data, std::size_t size) const {
+		return key_type(data, size);
+	}
+
+	/** New empty dict, reserved for the elements estimated from payload_size */
+	dict_type dict(std::size_t payload_size = 0) const {
+		dict_type dict;
+		dict.reserve(estimate_dict_size(payload_size));
+		return dict;
+	}
+};
+
+} // ::tnetstring
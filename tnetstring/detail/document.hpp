@@ -0,0 +1,502 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+
+namespace tnetstring {
+
+/**
+ * Node of a Document tape
+ */
+struct Tape_node {
+	/** Type character */
+	char type;
+
+	/** True for integers beyond std::int64_t, held in uint64 */
+	bool is_unsigned;
+
+	/** Index one past the last node of the subtree, i.e. of the next sibling */
+	std::uint32_t end;
+
+	/** Length of a string, count of elements of a list or dict (dict keys included) */
+	std::uint32_t size;
+
+	/** Decoded scalar payload */
+	union {
+		/** Offset of a string payload in the parsed buffer, so copies of a Document stay valid */
+		std::size_t string;
+		std::int64_t int64;
+		std::uint64_t uint64;
+		double real;
+		bool boolean;
+	};
+};
+
+/**
+ * Read-only handle of a node of a Document, valid as long as the Document is
+ * neither destroyed nor parsed again. Offers the queries of View.
+ */
+class Document_node {
+public:
+
+	class const_iterator;
+
+	/** CTOR, creates an invalid node (e.g. the result of an unsuccessful find) */
+	Document_node() : nodes_(nullptr), buffer_(nullptr), index_(0) {};
+
+	/** CTOR, handles the index-th node of the tape of a Document parsed from buffer */
+	Document_node(const Tape_node* nodes, const char* buffer, std::uint32_t index)
+		: nodes_(nodes), buffer_(buffer), index_(index) {};
+
+	/** False for invalid nodes */
+	explicit operator bool() const {
+		return nodes_ != nullptr;
+	}
+
+	/** Type character of the node */
+	char type() const {
+		return nodes_ != nullptr ? node().type : '\0';
+	}
+
+	/** True if the node is null */
+	bool is_null() const {
+		return type() == TNETSTRING_TAG_NULL;
+	}
+
+	/**
+	 * Count of elements of a list or dict, dict keys included
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	std::size_t size() const {
+		check_container();
+		return node().size;
+	}
+
+	/**
+	 * String payload, pointing into the parsed buffer
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	boost::string_view as_string_view() const {
+		check_type(TNETSTRING_TAG_STRING);
+		return boost::string_view(buffer_ + node().string, node().size);
+	}
+
+	/**
+	 * Integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	int as_int() const {
+		const std::int64_t int64_val = as_int64();
+		if (int64_val < std::numeric_limits<int>::min() || int64_val > std::numeric_limits<int>::max()) {
+			throw_range_exception("TNetstring payload cannot be casted to int");
+		}
+		return static_cast<int>(int64_val);
+	}
+
+	/**
+	 * 64 bit integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	std::int64_t as_int64() const {
+		check_type(TNETSTRING_TAG_INT);
+		if (node().is_unsigned) {
+			throw_range_exception("TNetstring payload cannot be casted to int64");
+		}
+		return node().int64;
+	}
+
+	/**
+	 * Unsigned 64 bit integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	std::uint64_t as_uint64() const {
+		check_type(TNETSTRING_TAG_INT);
+		if (!node().is_unsigned && node().int64 < 0) {
+			throw_range_exception("TNetstring payload cannot be casted to uint64");
+		}
+		return node().uint64;
+	}
+
+	/**
+	 * Float payload
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	double as_double() const {
+		check_type(TNETSTRING_TAG_FLOAT);
+		return node().real;
+	}
+
+	/**
+	 * Boolean payload
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	bool as_bool() const {
+		check_type(TNETSTRING_TAG_BOOLEAN);
+		return node().boolean;
+	}
+
+	/**
+	 * First element of a list or dict, dict elements alternate between key and value
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * End of the elements of a list or dict
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	const_iterator end() const;
+
+	/**
+	 * Looks up a key of the dict, keys are compared until the first match
+	 *
+	 * @throw tnetstring::Type_exception
+	 * @return the value or an invalid node if the key was not found
+	 */
+	Document_node find(boost::string_view key) const;
+
+	/**
+	 * Element of the list, located by skipping the subtrees before it
+	 *
+	 * @throw tnetstring::Type_exception
+	 * @return the element or an invalid node if the list is shorter
+	 */
+	Document_node at(std::size_t index) const;
+
+private:
+
+	/** Tape of the Document */
+	const Tape_node* nodes_;
+
+	/** Parsed buffer the string offsets refer to */
+	const char* buffer_;
+
+	/** Index of the handled node */
+	std::uint32_t index_;
+
+	const Tape_node& node() const {
+		return nodes_[index_];
+	}
+
+	/**
+	 * Throws if the node has not the expected type
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	void check_type(char expected) const {
+		if (type() != expected) {
+			Type_exception e;
+			e << Error_msg_info("TNetstring value has an unexpected type");
+			e << Parse_char_info(type());
+			BOOST_THROW_EXCEPTION(e);
+		}
+	}
+
+	/**
+	 * Throws if the node is neither a list nor a dict
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	void check_container() const {
+		if (type() != TNETSTRING_TAG_LIST && type() != TNETSTRING_TAG_DICT) {
+			Type_exception e;
+			e << Error_msg_info("TNetstring value is not a container");
+			e << Parse_char_info(type());
+			BOOST_THROW_EXCEPTION(e);
+		}
+	}
+
+	/** @throw tnetstring::Parse_exception */
+	void throw_range_exception(const std::string& error_msg) const {
+		Parse_exception e;
+		e << Error_msg_info(error_msg);
+		BOOST_THROW_EXCEPTION(e);
+	}
+
+};
+
+/**
+ * Forward iterator over the elements of a list or dict node
+ */
+class Document_node::const_iterator {
+public:
+
+	typedef std::forward_iterator_tag iterator_category;
+	typedef Document_node value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const Document_node* pointer;
+	typedef const Document_node& reference;
+
+	/** CTOR */
+	const_iterator() : current_() {};
+
+	/** CTOR, positions the iterator on the index-th node of the tape */
+	const_iterator(const Tape_node* nodes, const char* buffer, std::uint32_t index)
+		: current_(nodes, buffer, index) {};
+
+	const Document_node& operator*() const { return current_; }
+
+	const Document_node* operator->() const { return &current_; }
+
+	const_iterator& operator++() {
+		// the next sibling follows the subtree
+		current_.index_ = current_.node().end;
+		return *this;
+	}
+
+	const_iterator operator++(int) {
+		const_iterator old = *this;
+		++(*this);
+		return old;
+	}
+
+	bool operator==(const const_iterator& other) const {
+		return current_.index_ == other.current_.index_;
+	}
+
+	bool operator!=(const const_iterator& other) const {
+		return !(*this == other);
+	}
+
+private:
+	/** Current element */
+	Document_node current_;
+};
+
+
+inline Document_node::const_iterator Document_node::begin() const {
+	check_container();
+	return const_iterator(nodes_, buffer_, index_ + 1);
+}
+
+inline Document_node::const_iterator Document_node::end() const {
+	check_container();
+	return const_iterator(nodes_, buffer_, node().end);
+}
+
+inline Document_node Document_node::find(boost::string_view key) const {
+	check_type(TNETSTRING_TAG_DICT);
+
+	const_iterator end_it = end();
+	for (const_iterator it = begin(); it != end_it; ++it) {
+		const bool match = (it->as_string_view() == key);
+		// every key is followed by its value
+		++it;
+		if (match) {
+			return *it;
+		}
+	}
+	return Document_node();
+}
+
+inline Document_node Document_node::at(std::size_t index) const {
+	check_type(TNETSTRING_TAG_LIST);
+	if (index >= node().size) {
+		return Document_node();
+	}
+	const_iterator it = begin();
+	for (; index > 0; --index) {
+		++it;
+	}
+	return *it;
+}
+
+/**
+ * Tape document.
+ * Alternative to the TNetstring_value tree, storing a decoded TNetstring as one
+ * contiguous tape of fixed-size nodes in pre-order. Every node knows the index
+ * of its next sibling, so traversals walk the tape forwards and skip subtrees
+ * in one step. Strings are offsets into the parsed buffer, which has to outlive
+ * the Document unless the Document owns it; copies of a Document owning its
+ * buffer own a copy of it. Parsing again reuses the tape, so steady state
+ * parsing does not allocate.
+ */
+class Document {
+public:
+
+	/** CTOR, creates an empty document */
+	Document() : nodes_(), stack_(), source_(), buffer_(nullptr) {};
+
+	/** DTOR */
+	virtual ~Document() {};
+
+	/**
+	 * Parses the TNetstring at the beginning of the buffer, which has to outlive the Document
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return count of bytes consumed from the buffer
+	 */
+	std::size_t parse(const char* data, std::size_t size) {
+		source_.clear();
+		buffer_ = data;
+		return parse_buffer(size);
+	}
+
+	/**
+	 * Parses the TNetstring at the beginning of the string, the Document takes it over
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return count of bytes consumed from the string
+	 */
+	std::size_t parse(std::string data) {
+		source_ = std::move(data);
+		buffer_ = nullptr;
+		return parse_buffer(source_.size());
+	}
+
+	/** The parsed TNetstring, an invalid node if nothing is parsed */
+	Document_node root() const {
+		return nodes_.empty() ? Document_node() : Document_node(nodes_.data(), buffer(), 0);
+	}
+
+	/** Count of nodes on the tape */
+	std::size_t node_count() const {
+		return nodes_.size();
+	}
+
+private:
+
+	/** Nodes in pre-order */
+	std::vector<Tape_node> nodes_;
+
+	/** Indices of the open containers */
+	std::vector<std::uint32_t> stack_;
+
+	/** Parsed buffer, if the Document owns it */
+	std::string source_;
+
+	/** Parsed buffer, nullptr if the Document owns it */
+	const char* buffer_;
+
+	/** Parsed buffer, owned or not */
+	const char* buffer() const {
+		return buffer_ != nullptr ? buffer_ : source_.data();
+	}
+
+	/**
+	 * Parses the buffer into the tape
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	std::size_t parse_buffer(std::size_t size) {
+		nodes_.clear();
+		stack_.clear();
+		try {
+			return tnetstring::parse(buffer(), size, *this);
+		} catch (...) {
+			nodes_.clear();
+			throw;
+		}
+	}
+
+	std::uint32_t tape_size() const {
+		return static_cast<std::uint32_t>(nodes_.size());
+	}
+
+	/** Appends a node and counts it as element of the enclosing container */
+	Tape_node& push(char type) {
+		if (!stack_.empty()) {
+			nodes_[stack_.back()].size++;
+		}
+		nodes_.emplace_back();
+		Tape_node& node = nodes_.back();
+		node.type = type;
+		node.is_unsigned = false;
+		node.end = 0;
+		node.size = 0;
+		node.uint64 = 0;
+		return node;
+	}
+
+	/** Closes the innermost open container */
+	void end_container() {
+		nodes_[stack_.back()].end = tape_size();
+		stack_.pop_back();
+	}
+
+	// Parser handler, see Parser
+	friend class Parser<Document>;
+
+	void on_null() {
+		push(TNETSTRING_TAG_NULL).end = tape_size();
+	}
+
+	void on_bool(bool value) {
+		Tape_node& node = push(TNETSTRING_TAG_BOOLEAN);
+		node.boolean = value;
+		node.end = tape_size();
+	}
+
+	void on_int(std::int64_t value) {
+		Tape_node& node = push(TNETSTRING_TAG_INT);
+		node.int64 = value;
+		node.end = tape_size();
+	}
+
+	void on_uint(std::uint64_t value) {
+		Tape_node& node = push(TNETSTRING_TAG_INT);
+		node.uint64 = value;
+		node.is_unsigned = true;
+		node.end = tape_size();
+	}
+
+	void on_double(double value) {
+		Tape_node& node = push(TNETSTRING_TAG_FLOAT);
+		node.real = value;
+		node.end = tape_size();
+	}
+
+	void on_string(boost::string_view value) {
+		Tape_node& node = push(TNETSTRING_TAG_STRING);
+		node.string = value.data() - buffer();
+		node.size = static_cast<std::uint32_t>(value.size());
+		node.end = tape_size();
+	}
+
+	void begin_list() {
+		push(TNETSTRING_TAG_LIST);
+		stack_.push_back(tape_size() - 1);
+	}
+
+	void end_list() {
+		end_container();
+	}
+
+	void begin_dict() {
+		push(TNETSTRING_TAG_DICT);
+		stack_.push_back(tape_size() - 1);
+	}
+
+	void key(boost::string_view key) {
+		on_string(key);
+	}
+
+	void end_dict() {
+		end_container();
+	}
+
+};
+
+} // ::tnetstring
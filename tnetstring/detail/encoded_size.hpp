@@ -0,0 +1,166 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tnetstring {
+
+/**
+ * Encoded size calculator.
+ * Computes the exact count of bytes the encoders produce for a value,
+ * without producing any output.
+ */
+class Size_calculator : public boost::static_visitor<std::size_t> {
+
+public:
+	/** CTOR */
+	Size_calculator() : container_sizes_(nullptr), cut_containers_(true) {}
+
+	/**
+	 * CTOR
+	 *
+	 * @param container_sizes receives the payload size of every visited list and dict, in pre-order
+	 * @param cut_containers false to size lists and dicts with their uncut payloads, i.e. the
+	 *        space needed to encode a value before its containers are cut
+	 */
+	explicit Size_calculator(std::vector<std::size_t>* container_sizes, bool cut_containers = true)
+		: container_sizes_(container_sizes), cut_containers_(cut_containers) {}
+
+	/** String netstring size */
+	std::size_t operator()(const std::string& str_val) const {
+		return tnetstring_size(str_val.size());
+	}
+
+	/** Cstring / nullptr netstring size */
+	std::size_t operator()(const char* cstring_val) const {
+		if (cstring_val != nullptr) {
+			return tnetstring_size(std::strlen(cstring_val));
+		} else {
+			return TNETSTRING_NULL.size();
+		}
+	}
+
+	/** Integer netstring size */
+	std::size_t operator()(const int& int_val) const {
+		char msg[INT_FORMAT_MAXLEN];
+		return tnetstring_size(format_int(int_val, msg));
+	}
+
+	/** 64 bit integer netstring size */
+	std::size_t operator()(const std::int64_t& int64_val) const {
+		char msg[INT64_FORMAT_MAXLEN];
+		return tnetstring_size(format_int64(int64_val, msg));
+	}
+
+	/** Unsigned 64 bit integer netstring size */
+	std::size_t operator()(const std::uint64_t& uint64_val) const {
+		char msg[INT64_FORMAT_MAXLEN];
+		return tnetstring_size(format_uint64(uint64_val, msg));
+	}
+
+	/** Double netstring size */
+	std::size_t operator()(const double& double_val) const {
+		char msg[DOUBLE_FORMAT_MAXLEN];
+		return tnetstring_size(format_double(double_val, msg));
+	}
+
+	/** Boolean netstring size */
+	std::size_t operator()(const bool& bool_val) const {
+		return tnetstring_size(bool_val ? 4 : 5);
+	}
+
+	/** List netstring size */
+	std::size_t operator()(const TNetstring_list& list_val) const {
+		const std::size_t slot = reserve_container_size();
+		std::size_t len = 0;
+		for (const TNetstring_value& i: list_val) {
+			len += boost::apply_visitor(*this, i);
+		}
+		record_container_size(slot, len);
+		return container_size(len);
+	}
+
+	/** Dict netstring size */
+	std::size_t operator()(const TNetstring_dict& dict_val) const {
+		const std::size_t slot = reserve_container_size();
+		std::size_t len = 0;
+		for (const TNetstring_dict::value_type& i: dict_val) {
+			len += tnetstring_size(i.first.size());
+			len += boost::apply_visitor(*this, i.second);
+		}
+		record_container_size(slot, len);
+		return container_size(len);
+	}
+
+	/** Count of decimal digits of n */
+	static std::size_t digits(std::size_t n) {
+		std::size_t count = 1;
+		while (n >= 10) {
+			n /= 10;
+			count++;
+		}
+		return count;
+	}
+
+	/** Size of a TNetstring with a payload of len bytes, cut after TNETSTRING_DATA_MAXLEN */
+	static std::size_t tnetstring_size(std::size_t len) {
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+		// size field, delimiter, payload and type character
+		return digits(len) + 1 + len + 1;
+	}
+
+private:
+	/** Payload sizes of the visited containers, or nullptr if they are not recorded */
+	std::vector<std::size_t>* container_sizes_;
+
+	/** False if list and dict payloads are not cut after TNETSTRING_DATA_MAXLEN */
+	bool cut_containers_;
+
+	/** Size of a list or dict with a payload of len bytes */
+	std::size_t container_size(std::size_t len) const {
+		return cut_containers_ ? tnetstring_size(len) : digits(len) + 1 + len + 1;
+	}
+
+	/** Reserves the pre-order slot of the container being visited */
+	std::size_t reserve_container_size() const {
+		if (container_sizes_ == nullptr) {
+			return 0;
+		}
+		container_sizes_->push_back(0);
+		return container_sizes_->size() - 1;
+	}
+
+	/** Records the (uncut) payload size of a visited container */
+	void record_container_size(std::size_t slot, std::size_t len) const {
+		if (container_sizes_ != nullptr) {
+			(*container_sizes_)[slot] = len;
+		}
+	}
+};
+
+/**
+ * Exact count of bytes value encodes to
+ */
+inline std::size_t encoded_size(const TNetstring_value& value) {
+	return boost::apply_visitor(Size_calculator(), value);
+}
+
+/**
+ * Count of bytes value encodes to before lists and dicts are cut after TNETSTRING_DATA_MAXLEN,
+ * at least encoded_size()
+ */
+inline std::size_t uncut_encoded_size(const TNetstring_value& value) {
+	return boost::apply_visitor(Size_calculator(nullptr, false), value);
+}
+
+} // ::tnetstring
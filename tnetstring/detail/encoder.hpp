@@ -6,116 +6,249 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstring>
 #include <sstream>
-#include <boost/lexical_cast.hpp>
+#include <string>
+#include <vector>
 
 namespace tnetstring {
 
+/**
+ * Encoding pass.
+ * Internally used by Encoder to write one TNetstring_value to a stream.
+ *
+ * Values are visited by reference and written straight to the stream.
+ * The payload sizes of all lists and dicts of an outermost container are
+ * passed in, computed up front in a single pass, so nested containers need
+ * no intermediate buffers.
+ */
+class Encoding_pass : public boost::static_visitor<> {
+
+public:
+	/**
+	 * CTOR
+	 *
+	 * @param container_sizes payload sizes of the containers of the encoded value, in pre-order
+	 */
+	Encoding_pass(std::ostream& outstream, const std::vector<std::size_t>& container_sizes)
+		: outstream_(&outstream), container_sizes_(&container_sizes), next_container_(0) {}
+
+	/** DTOR */
+	virtual ~Encoding_pass() {}
+
+	/** String netstring encoding */
+	void operator()(const std::string& str_val) {
+		outstream_tnetstring(str_val.data(), str_val.size(), TNETSTRING_TAG_STRING);
+	}
+
+	/** Cstring / nullptr netstring encoding */
+	void operator()(const char* cstring_val) {
+		if (cstring_val != nullptr) {
+			outstream_tnetstring(cstring_val, std::strlen(cstring_val), TNETSTRING_TAG_STRING);
+		} else {
+			*outstream_ << TNETSTRING_NULL;
+		}
+	}
+
+	/** Integer netstring encoding */
+	void operator()(const int& int_val) {
+		char msg[INT_FORMAT_MAXLEN];
+		outstream_tnetstring(msg, format_int(int_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** 64 bit integer netstring encoding */
+	void operator()(const std::int64_t& int64_val) {
+		char msg[INT64_FORMAT_MAXLEN];
+		outstream_tnetstring(msg, format_int64(int64_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** Unsigned 64 bit integer netstring encoding */
+	void operator()(const std::uint64_t& uint64_val) {
+		char msg[INT64_FORMAT_MAXLEN];
+		outstream_tnetstring(msg, format_uint64(uint64_val, msg), TNETSTRING_TAG_INT);
+	}
+
+	/** Double netstring encoding */
+	void operator()(const double& double_val) {
+		char msg[DOUBLE_FORMAT_MAXLEN];
+		outstream_tnetstring(msg, format_double(double_val, msg), TNETSTRING_TAG_FLOAT);
+	}
+
+	/** Boolean netstring encoding */
+	void operator()(const bool& bool_val) {
+		if (bool_val) {
+			outstream_tnetstring("true", 4, TNETSTRING_TAG_BOOLEAN);
+		} else {
+			outstream_tnetstring("false", 5, TNETSTRING_TAG_BOOLEAN);
+		}
+	}
+
+	/** List netstring encoding */
+	void operator()(const TNetstring_list& list_val) {
+		outstream_container(list_val, TNETSTRING_TAG_LIST);
+	}
+
+	/** Dict netstring encoding */
+	void operator()(const TNetstring_dict& dict_val) {
+		outstream_container(dict_val, TNETSTRING_TAG_DICT);
+	}
+
+private:
+	/** Output stream, redirected while an oversized container is buffered */
+	std::ostream* outstream_;
+
+	/** Payload sizes of the containers of the encoded value, in pre-order */
+	const std::vector<std::size_t>* container_sizes_;
+
+	/** Index of the next container in container_sizes_ */
+	std::size_t next_container_;
+
+	/** Outputs a Netstring encoded message of len bytes to outstream */
+	void outstream_tnetstring(const char* msg, std::size_t len, const char tag) {
+		// limit to TNETSTRING_MAXSIZE (cut data after MAXSIZE)
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			// limit length
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+
+		outstream_size(len);
+		outstream_->write(msg, len);
+		*outstream_ << tag;
+	}
+
+	/** Outputs size digits and the size delimiter */
+	void outstream_size(std::size_t len) {
+		char length[INT64_FORMAT_MAXLEN];
+		const std::size_t length_digits = format_uint64(len, length);
+		outstream_->write(length, length_digits);
+		*outstream_ << TNETSTRING_SIZE_DELIM;
+	}
+
+	/**
+	 * Outputs a list or dict.
+	 * Payloads exceeding TNETSTRING_DATA_MAXLEN are buffered and cut.
+	 */
+	template <typename Container>
+	void outstream_container(const Container& container, const char tag) {
+		const std::size_t len = (*container_sizes_)[next_container_++];
+
+		if (len <= static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN)) {
+			outstream_size(len);
+			outstream_elements(container);
+			*outstream_ << tag;
+		} else {
+			std::ostream* outstream = outstream_;
+			std::ostringstream os;
+			outstream_ = &os;
+			outstream_elements(container);
+			outstream_ = outstream;
+
+			const std::string msg = os.str();
+			outstream_tnetstring(msg.data(), msg.size(), tag);
+		}
+	}
+
+	/** Outputs the elements of a list */
+	void outstream_elements(const TNetstring_list& list_val) {
+		for (const TNetstring_value& i: list_val) {
+			boost::apply_visitor(*this, i);
+		}
+	}
+
+	/** Outputs the keys and values of a dict, keys are written as plain strings */
+	void outstream_elements(const TNetstring_dict& dict_val) {
+		for (const TNetstring_dict::value_type& i: dict_val) {
+			outstream_tnetstring(i.first.data(), i.first.size(), TNETSTRING_TAG_STRING);
+			boost::apply_visitor(*this, i.second);
+		}
+	}
+};
+
 /**
  * Encoder.
  * Internally used to encode TNetstrings to streams.
+ *
+ * Every visited value is written by its own Encoding_pass, lists and dicts
+ * are sized with all their nested containers in a single pass first. The
+ * encoder keeps no state between values, so it can be applied as const or
+ * temporary visitor and a failed encoding does not affect the next one.
  */
 class Encoder : public boost::static_visitor<> {
 
 public:
 	/** CTOR */
-	Encoder(std::ostream& outstream): outstream_(outstream) {}
+	Encoder(std::ostream& outstream): outstream_(&outstream) {}
 
 	/** DTOR */
 	virtual ~Encoder() {}
 
 	/** String netstring encoding */
 	void operator()(const std::string& str_val) const {
-		outstream_tnetstring(str_val, TNETSTRING_TAG_STRING);
+		encode_scalar(str_val);
 	}
 
 	/** Cstring / nullptr netstring encoding */
 	void operator()(const char* cstring_val) const {
-		if (cstring_val != nullptr) {
-			const std::string msg = cstring_val;
-			outstream_tnetstring(msg, TNETSTRING_TAG_STRING);
-		} else {
-			outstream_ << TNETSTRING_NULL;
-		}
+		encode_scalar(cstring_val);
 	}
 
 	/** Integer netstring encoding */
 	void operator()(const int& int_val) const {
-		try {
-			const std::string msg = boost::lexical_cast<std::string>(int_val);
-			outstream_tnetstring(msg, TNETSTRING_TAG_INT);
-		} catch (boost::bad_lexical_cast&) {
-			outstream_ << TNETSTRING_EMPTY;
-		}
+		encode_scalar(int_val);
+	}
+
+	/** 64 bit integer netstring encoding */
+	void operator()(const std::int64_t& int64_val) const {
+		encode_scalar(int64_val);
+	}
+
+	/** Unsigned 64 bit integer netstring encoding */
+	void operator()(const std::uint64_t& uint64_val) const {
+		encode_scalar(uint64_val);
 	}
 
 	/** Double netstring encoding */
 	void operator()(const double& double_val) const {
-		try {
-			const std::string msg = boost::lexical_cast<std::string>(double_val);
-			outstream_tnetstring(msg, TNETSTRING_TAG_FLOAT);
-		} catch (boost::bad_lexical_cast&) {
-			outstream_ << TNETSTRING_EMPTY;
-		}
+		encode_scalar(double_val);
 	}
 
 	/** Boolean netstring encoding */
 	void operator()(const bool& bool_val) const {
-		std::string msg;
-		bool_val ? msg = "true" : msg = "false";
-		outstream_tnetstring(msg, TNETSTRING_TAG_BOOLEAN);
+		encode_scalar(bool_val);
 	}
 
 	/** List netstring encoding */
 	void operator()(const TNetstring_list& list_val) const {
-		std::ostringstream os;
-
-		for (auto i: list_val) {
-			boost::apply_visitor(Encoder(os), i);
-		}
-
-		outstream_tnetstring(os.str(), TNETSTRING_TAG_LIST);
+		encode_container(list_val);
 	}
 
 	/** Dict netstring encoding */
 	void operator()(const TNetstring_dict& dict_val) const {
-		std::ostringstream os;
-
-		for (auto i: dict_val) {
-			TNetstring_value key = i.first;
-			boost::apply_visitor(Encoder(os), key);
-			boost::apply_visitor(Encoder(os), i.second);
-		}
-
-		outstream_tnetstring(os.str(), TNETSTRING_TAG_DICT);
+		encode_container(dict_val);
 	}
 
 private:
 	/** Output stream */
-	std::ostream& outstream_;
+	std::ostream* outstream_;
 
-	/** Outputs a Netstring encoded message to outstream */
-	void outstream_tnetstring(const std::string& msg, const char tag) const {
-		try {
-			// get length of the msg
-			int len = msg.size();
-
-			// limit to TNETSTRING_MAXSIZE (cut data after MAXSIZE)
-			if (TNETSTRING_DATA_MAXLEN < len) {
-				// limit length
-				len = TNETSTRING_DATA_MAXLEN;
-			}
-
-			// cast actual length to string
-			std::string length = boost::lexical_cast<std::string>(len);
+	/** Outputs a value without containers */
+	template <typename Value>
+	void encode_scalar(const Value& value) const {
+		const std::vector<std::size_t> no_containers;
+		Encoding_pass pass(*outstream_, no_containers);
+		pass(value);
+	}
 
-			// write netstring to output stream
-			outstream_ << length << TNETSTRING_SIZE_DELIM << msg.substr(0,len) << tag;
+	/** Outputs a list or dict, sizing it and all the nested ones in a single pass first */
+	template <typename Container>
+	void encode_container(const Container& container) const {
+		std::vector<std::size_t> container_sizes;
+		Size_calculator calculator(&container_sizes);
+		calculator(container);
 
-		} catch (boost::bad_lexical_cast&) {
-			// return nothing (not NULL)
-			outstream_ << TNETSTRING_NULL;
-		}
+		Encoding_pass pass(*outstream_, container_sizes);
+		pass(container);
 	}
 };
 
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <exception>
 #include <boost/exception/all.hpp>
 
@@ -15,6 +16,10 @@ struct Exception : virtual std::exception, virtual boost::exception {};
 
 struct Parse_exception : virtual Exception {};
 
+struct Type_exception : virtual Exception {};
+
+struct Io_exception : virtual Exception {};
+
 typedef boost::error_info<struct tag_error_msg, std::string> Error_msg_info;
 
 typedef boost::error_info<struct tag_count, int> Count_info;
@@ -27,5 +32,7 @@ typedef boost::error_info<struct tag_parse_char, char> Parse_char_info;
 
 typedef boost::error_info<struct tag_parse_value, std::string> Parse_value_info;
 
+typedef boost::error_info<struct tag_offset, std::size_t> Offset_info;
+
 } // ::tnetstring
 
@@ -0,0 +1,269 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace tnetstring {
+
+/**
+ * Frame index sidecar files.
+ *
+ * A sidecar lists the offsets of the top-level TNetstrings (frames) of a file of
+ * back-to-back TNetstrings. It starts with an 8 byte header, "TNSIDX" followed by
+ * '1' and the record kind: 'o' for records of a 64 bit offset, 'k' for records of
+ * a 64 bit offset followed by the 64 bit integer key of the frame, the value of a
+ * chosen dict field like a timestamp. Records are stored in native byte order.
+ */
+const char FRAME_INDEX_MAGIC[] = "TNSIDX1";
+
+/** Size of the sidecar header */
+const std::size_t FRAME_INDEX_HEADER_SIZE = 8;
+
+/** Record kind of sidecars with offsets only */
+const char FRAME_INDEX_OFFSETS = 'o';
+
+/** Record kind of sidecars with offsets and keys */
+const char FRAME_INDEX_KEYED = 'k';
+
+/**
+ * Frame index builder.
+ * Scans a file of back-to-back TNetstrings by their size fields only and appends the
+ * offsets of its frames to a sidecar. Frames appended to the file later are indexed
+ * by the next update(), the frames indexed before are not scanned again.
+ */
+class Frame_index_builder {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param data_path file of back-to-back TNetstrings
+	 * @param index_path sidecar, created by the first update()
+	 * @param key dict field holding the integer key of every frame, empty for offsets only
+	 */
+	Frame_index_builder(const std::string& data_path, const std::string& index_path, const std::string& key = "")
+		: data_path_(data_path), index_path_(index_path), key_(key) {};
+
+	/** DTOR */
+	virtual ~Frame_index_builder() {};
+
+	/**
+	 * Indexes the complete frames not indexed yet
+	 *
+	 * @throw tnetstring::Io_exception, tnetstring::Parse_exception tagged with the Offset_info of a
+	 *        malformed frame, tnetstring::Type_exception if a frame is no dict with an integer key
+	 * @return count of frames added to the sidecar
+	 */
+	std::size_t update() {
+		const char kind = key_.empty() ? FRAME_INDEX_OFFSETS : FRAME_INDEX_KEYED;
+		const std::size_t record_size = kind == FRAME_INDEX_KEYED ? 16 : 8;
+		Mapped_reader reader(data_path_);
+
+		// resume behind the last indexed frame
+		std::size_t count = 0;
+		std::ifstream existing(index_path_, std::ios::binary | std::ios::ate);
+		const bool exists = existing.is_open();
+		if (exists) {
+			const std::size_t index_size = static_cast<std::size_t>(existing.tellg());
+			char header[FRAME_INDEX_HEADER_SIZE];
+			existing.seekg(0);
+			if (!existing.read(header, FRAME_INDEX_HEADER_SIZE) ||
+			    std::memcmp(header, FRAME_INDEX_MAGIC, FRAME_INDEX_HEADER_SIZE - 1) != 0 ||
+			    header[FRAME_INDEX_HEADER_SIZE - 1] != kind ||
+			    (index_size - FRAME_INDEX_HEADER_SIZE) % record_size != 0) {
+				throw_io_exception("Frame index does not match", index_path_);
+			}
+			count = (index_size - FRAME_INDEX_HEADER_SIZE) / record_size;
+			if (count != 0) {
+				std::uint64_t last_offset;
+				existing.seekg(FRAME_INDEX_HEADER_SIZE + (count - 1) * record_size);
+				if (!existing.read(reinterpret_cast<char*>(&last_offset), sizeof(last_offset))) {
+					throw_io_exception("Cannot read frame index", index_path_);
+				}
+				View last;
+				reader.seek(count - 1, last_offset);
+				if (!reader.next(last)) {
+					throw_io_exception("Frame index does not match", index_path_);
+				}
+			}
+		}
+		existing.close();
+
+		std::vector<char> records;
+		if (!exists) {
+			records.insert(records.end(), FRAME_INDEX_MAGIC, FRAME_INDEX_MAGIC + FRAME_INDEX_HEADER_SIZE - 1);
+			records.push_back(kind);
+		}
+		std::size_t added = 0;
+		View frame;
+		while (reader.next(frame)) {
+			append_record(records, static_cast<std::uint64_t>(frame.data() - reader.data()));
+			if (kind == FRAME_INDEX_KEYED) {
+				try {
+					const View key = frame.find(key_);
+					if (!key) {
+						Type_exception e;
+						e << Error_msg_info("TNetstring frame has no key field");
+						BOOST_THROW_EXCEPTION(e);
+					}
+					append_record(records, key.as_int64());
+				} catch (boost::exception& e) {
+					e << Offset_info(frame.data() - reader.data());
+					throw;
+				}
+			}
+			added++;
+		}
+
+		if (!records.empty()) {
+			std::ofstream index(index_path_, std::ios::binary | std::ios::app);
+			if (!index.write(records.data(), records.size()) || !index.flush()) {
+				throw_io_exception("Cannot write frame index", index_path_);
+			}
+		}
+		return added;
+	}
+
+private:
+
+	/** File of back-to-back TNetstrings */
+	std::string data_path_;
+
+	/** Sidecar */
+	std::string index_path_;
+
+	/** Dict field holding the key of every frame, empty for offsets only */
+	std::string key_;
+
+	/** Appends a 64 bit record field in native byte order */
+	template <typename Value>
+	static void append_record(std::vector<char>& records, Value value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		records.insert(records.end(), bytes, bytes + sizeof(value));
+	}
+
+};
+
+/**
+ * Frame index.
+ * Maps a sidecar written by Frame_index_builder and looks up the offsets of frames
+ * by their index in constant time, or by their key with a binary search if the keys
+ * are in ascending order, like timestamps.
+ *
+ * The index reflects the sidecar at construction time.
+ */
+class Frame_index {
+public:
+
+	/**
+	 * CTOR, maps the sidecar
+	 *
+	 * @throw tnetstring::Io_exception
+	 */
+	explicit Frame_index(const std::string& index_path)
+		: mapping_(index_path, ACCESS_RANDOM), records_(nullptr), record_size_(0), count_(0) {
+		if (mapping_.size() < FRAME_INDEX_HEADER_SIZE ||
+		    std::memcmp(mapping_.data(), FRAME_INDEX_MAGIC, FRAME_INDEX_HEADER_SIZE - 1) != 0) {
+			throw_io_exception("File is no frame index", index_path);
+		}
+		const char kind = mapping_.data()[FRAME_INDEX_HEADER_SIZE - 1];
+		if (kind != FRAME_INDEX_KEYED && kind != FRAME_INDEX_OFFSETS) {
+			throw_io_exception("File is no frame index", index_path);
+		}
+		record_size_ = kind == FRAME_INDEX_KEYED ? 16 : 8;
+		records_ = mapping_.data() + FRAME_INDEX_HEADER_SIZE;
+		count_ = (mapping_.size() - FRAME_INDEX_HEADER_SIZE) / record_size_;
+	};
+
+	/** DTOR */
+	virtual ~Frame_index() {};
+
+	/** Count of indexed frames */
+	std::size_t count() const {
+		return count_;
+	}
+
+	/** True if the frames are indexed with keys */
+	bool keyed() const {
+		return record_size_ == 16;
+	}
+
+	/** Offset of the index-th frame from the beginning of the file */
+	std::size_t offset(std::size_t index) const {
+		return static_cast<std::size_t>(field<std::uint64_t>(index, 0));
+	}
+
+	/** Key of the index-th frame, keyed indexes only */
+	std::int64_t key(std::size_t index) const {
+		return field<std::int64_t>(index, 8);
+	}
+
+	/**
+	 * Index of the first frame with a key not less than key, keyed indexes only
+	 *
+	 * @return count() if there is no such frame
+	 */
+	std::size_t lower_bound(std::int64_t key) const {
+		std::size_t first = 0;
+		std::size_t length = count_;
+		while (length > 0) {
+			const std::size_t half = length / 2;
+			if (this->key(first + half) < key) {
+				first += half + 1;
+				length -= half + 1;
+			} else {
+				length = half;
+			}
+		}
+		return first;
+	}
+
+	/**
+	 * Moves the reader of the indexed file to the index-th frame
+	 *
+	 * @return false if the frame is not indexed
+	 */
+	bool seek(Mapped_reader& reader, std::size_t index) const {
+		if (index >= count_) {
+			return false;
+		}
+		reader.seek(index, offset(index));
+		return true;
+	}
+
+private:
+
+	/** Mapping of the sidecar */
+	Mapped_reader mapping_;
+
+	/** First record */
+	const char* records_;
+
+	/** Size of a record */
+	std::size_t record_size_;
+
+	/** Count of records */
+	std::size_t count_;
+
+	/** Reads a record field, records are not necessarily aligned */
+	template <typename Value>
+	Value field(std::size_t index, std::size_t field_offset) const {
+		Value value;
+		std::memcpy(&value, records_ + index * record_size_ + field_offset, sizeof(value));
+		return value;
+	}
+
+};
+
+} // ::tnetstring
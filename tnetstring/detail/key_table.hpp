@@ -0,0 +1,261 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+#include <boost/variant.hpp>
+
+
+namespace tnetstring {
+
+/**
+ * Default limit of the count of names of a Key_table
+ */
+const std::size_t KEY_TABLE_SIZE_MAX = 65536;
+
+/**
+ * Interned dict key.
+ * Handle of a name held by a Key_table, keys of the same table are equal if
+ * and only if their names are, so comparing keys compares pointers.
+ */
+class Key {
+public:
+
+	/** CTOR, creates an invalid key (e.g. the result of an unsuccessful find) */
+	Key() : name_(nullptr) {};
+
+	/** CTOR, handles a name held by a Key_table */
+	explicit Key(const std::string* name) : name_(name) {};
+
+	/** False for invalid keys */
+	explicit operator bool() const {
+		return name_ != nullptr;
+	}
+
+	/** Name of the key, empty for invalid keys */
+	boost::string_view str() const {
+		return name_ != nullptr ? boost::string_view(*name_) : boost::string_view();
+	}
+
+	/** Address of the name, stable as long as the Key_table lives */
+	const std::string* id() const {
+		return name_;
+	}
+
+	bool operator==(const Key& other) const { return name_ == other.name_; }
+	bool operator!=(const Key& other) const { return name_ != other.name_; }
+
+private:
+	/** Name held by the Key_table */
+	const std::string* name_;
+};
+
+/**
+ * Intern table of dict key names.
+ * Every distinct name is stored once and keeps its address until the table is
+ * cleared or destroyed, so a table shared by many decodes stores each repeated
+ * key only once. Names are never evicted, so the count of names is limited to
+ * keep untrusted data from growing the table without bound. The table is not
+ * thread-safe, use one table per thread.
+ */
+class Key_table {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param max_size count of names beyond which interning a new name fails
+	 */
+	explicit Key_table(std::size_t max_size = KEY_TABLE_SIZE_MAX) : names_(), slots_(), max_size_(max_size) {};
+
+	/** DTOR */
+	virtual ~Key_table() {};
+
+	Key_table(const Key_table&) = delete;
+	Key_table& operator=(const Key_table&) = delete;
+
+	/**
+	 * Key of name, the name is added if it is new
+	 *
+	 * @throw tnetstring::Parse_exception if the name is new and the table holds max_size() names
+	 */
+	Key intern(boost::string_view name) {
+		if (2 * (names_.size() + 1) > slots_.size()) {
+			rehash(slots_.empty() ? 64 : 2 * slots_.size());
+		}
+		const std::size_t slot = probe(name);
+		if (slots_[slot] == 0) {
+			if (names_.size() >= max_size_) {
+				Parse_exception e;
+				e << Error_msg_info("Too many distinct dict keys");
+				e << Count_info(static_cast<int>(names_.size()));
+				BOOST_THROW_EXCEPTION(e);
+			}
+			names_.emplace_back(name.data(), name.size());
+			slots_[slot] = static_cast<std::uint32_t>(names_.size());
+		}
+		return Key(&names_[slots_[slot] - 1]);
+	}
+
+	/** Key of name or an invalid key if name was never interned */
+	Key find(boost::string_view name) const {
+		if (slots_.empty()) {
+			return Key();
+		}
+		const std::uint32_t index = slots_[probe(name)];
+		return index != 0 ? Key(&names_[index - 1]) : Key();
+	}
+
+	/** Count of names */
+	std::size_t size() const {
+		return names_.size();
+	}
+
+	/** Count of names beyond which interning a new name fails */
+	std::size_t max_size() const {
+		return max_size_;
+	}
+
+	/** Removes all names, keys and dicts holding keys of the table become invalid */
+	void clear() {
+		names_.clear();
+		slots_.clear();
+	}
+
+private:
+
+	/** Names in the order they were interned, a deque keeps their addresses */
+	std::deque<std::string> names_;
+
+	/** Name index + 1 per slot, 0 for empty slots, probed linearly, see Basic_hash_dict */
+	std::vector<std::uint32_t> slots_;
+
+	/** Count of names beyond which interning a new name fails */
+	std::size_t max_size_;
+
+	/** Slot of name, or the empty slot it would be inserted into */
+	std::size_t probe(boost::string_view name) const {
+		const std::size_t mask = slots_.size() - 1;
+		std::size_t slot = hash_key(name) & mask;
+		while (slots_[slot] != 0 && names_[slots_[slot] - 1] != name) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	/** Rebuilds the table with size slots */
+	void rehash(std::size_t size) {
+		slots_.assign(size, 0);
+		for (std::size_t i = 0; i < names_.size(); i++) {
+			slots_[probe(names_[i])] = static_cast<std::uint32_t>(i + 1);
+		}
+	}
+
+};
+
+/**
+ * Key traits of dicts with interned keys, hashed and compared by address
+ */
+struct Interned_key_traits {
+	typedef Key key_type;
+	typedef Key lookup_type;
+
+	static std::size_t hash(lookup_type key) {
+		// names are at least pointer aligned, mix the higher bits down
+		const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(key.id());
+		return static_cast<std::size_t>((address >> 4) ^ (address >> 16));
+	}
+};
+
+class Interned_value;
+
+/**
+ * TNetstring list of Interned_values
+ */
+typedef std::vector<Interned_value> Interned_list;
+
+/**
+ * TNetstring dictionary with interned keys
+ */
+typedef Basic_hash_dict<Interned_value, Interned_key_traits> Interned_dict;
+
+/**
+ * Variant base of Interned_value
+ */
+typedef boost::variant<
+	const char*
+	, int
+	, std::int64_t
+	, std::uint64_t
+	, std::string
+	, double
+	, bool
+	, Interned_list
+	, Interned_dict
+> Interned_variant;
+
+/**
+ * TNetstring value with Interned_dicts, holds the same types as TNetstring_value.
+ * The recursion is resolved by deriving from the variant, see Arena_value.
+ */
+class Interned_value : public Interned_variant {
+public:
+	using Interned_variant::Interned_variant;
+	using Interned_variant::operator=;
+
+	/** CTOR */
+	Interned_value() : Interned_variant() {}
+};
+
+/**
+ * Decoded tree of Interned_values, dict keys are interned into a Key_table, see Heap_tree
+ */
+class Interned_tree {
+public:
+	typedef Interned_value value_type;
+	typedef std::string string_type;
+	typedef Interned_list list_type;
+	typedef Interned_dict dict_type;
+	typedef Key key_type;
+
+	/** CTOR */
+	Interned_tree(Key_table& keys) : keys_(&keys) {}
+
+	/** New string payload */
+	string_type string(const char* data, std::size_t size) const {
+		return string_type(data, size);
+	}
+
+	/** New empty list */
+	list_type list() const {
+		return list_type();
+	}
+
+	/** Interned dict key */
+	key_type key(const char* data, std::size_t size) const {
+		return keys_->intern(boost::string_view(data, size));
+	}
+
+	/** New empty dict, reserved for the elements estimated from payload_size */
+	dict_type dict(std::size_t payload_size = 0) const {
+		dict_type dict;
+		dict.reserve(estimate_dict_size(payload_size));
+		return dict;
+	}
+
+private:
+	/** Table the keys are interned into */
+	Key_table* keys_;
+};
+
+} // ::tnetstring
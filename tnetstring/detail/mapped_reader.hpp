@@ -0,0 +1,244 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace tnetstring {
+
+/** Access pattern hints for Mapped_reader, see madvise() */
+enum Access_hint {
+	ACCESS_NORMAL,
+	ACCESS_SEQUENTIAL,
+	ACCESS_RANDOM
+};
+
+/**
+ * Throws an Io_exception for a failed file operation, tagged with errno and the file name
+ *
+ * @throw tnetstring::Io_exception
+ */
+inline void throw_io_exception(const std::string& error_msg, const std::string& path) {
+	Io_exception e;
+	e << Error_msg_info(error_msg);
+	e << boost::errinfo_errno(errno);
+	e << boost::errinfo_file_name(path);
+	BOOST_THROW_EXCEPTION(e);
+}
+
+/**
+ * Memory-mapped reader.
+ * Maps a file of back-to-back TNetstrings, e.g. an archive of captures, and
+ * iterates its top-level TNetstrings as Views into the mapping, without
+ * copying nor decoding them. A trailing incomplete TNetstring, e.g. of a file
+ * still being written, ends the iteration.
+ *
+ * The Views are valid as long as the reader.
+ */
+class Mapped_reader {
+public:
+
+	/** Count of TNetstrings between the offsets remembered for seek() */
+	static const std::size_t SEEK_STRIDE = 1024;
+
+	/**
+	 * CTOR, maps the file
+	 *
+	 * @throw tnetstring::Io_exception
+	 * @param path file to map
+	 * @param hint expected access pattern
+	 */
+	explicit Mapped_reader(const std::string& path, Access_hint hint = ACCESS_SEQUENTIAL)
+		: data_(nullptr), size_(0), pos_(0), index_(0), offsets_(1, 0) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw_io_exception("Cannot open file", path);
+		}
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			const int error = errno;
+			::close(fd);
+			errno = error;
+			throw_io_exception("Cannot stat file", path);
+		}
+		size_ = static_cast<std::size_t>(info.st_size);
+
+		// an empty file cannot be mapped
+		if (size_ != 0) {
+			void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				const int error = errno;
+				::close(fd);
+				errno = error;
+				throw_io_exception("Cannot map file", path);
+			}
+			data_ = static_cast<const char*>(data);
+		}
+		// the mapping stays valid without the descriptor
+		::close(fd);
+		advise(hint);
+	};
+
+	Mapped_reader(const Mapped_reader&) = delete;
+	Mapped_reader& operator=(const Mapped_reader&) = delete;
+
+	/** DTOR, unmaps the file */
+	virtual ~Mapped_reader() {
+		if (data_ != nullptr) {
+			::munmap(const_cast<char*>(data_), size_);
+		}
+	};
+
+	/** Passes an access pattern hint for the mapping to the kernel */
+	void advise(Access_hint hint) {
+		if (data_ == nullptr) {
+			return;
+		}
+		const int advice = hint == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL :
+		                   hint == ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL;
+		// only a hint, failures are harmless
+		::madvise(const_cast<char*>(data_), size_, advice);
+	}
+
+	/**
+	 * Views the next TNetstring and advances behind it
+	 *
+	 * @throw tnetstring::Parse_exception, tagged with the Offset_info of the malformed TNetstring
+	 * @param view the View of the TNetstring
+	 * @return false at the end of the file or of its complete TNetstrings
+	 */
+	bool next(View& view) {
+		const std::size_t frame_size = frame_size_at(pos_);
+		if (frame_size == 0) {
+			return false;
+		}
+		view = View(data_ + pos_, frame_size);
+		advance(frame_size);
+		return true;
+	}
+
+	/**
+	 * Moves to the index-th TNetstring of the file. Size fields are scanned from the
+	 * closest remembered offset, so seeking backwards and to visited regions is cheap.
+	 *
+	 * @throw tnetstring::Parse_exception, tagged with the Offset_info of the malformed TNetstring
+	 * @return false if the file has fewer complete TNetstrings, the reader is then left behind the last one
+	 */
+	bool seek(std::size_t index) {
+		const std::size_t checkpoint = std::min(index / SEEK_STRIDE, offsets_.size() - 1);
+		if (index < index_ || checkpoint * SEEK_STRIDE > index_) {
+			index_ = checkpoint * SEEK_STRIDE;
+			pos_ = offsets_[checkpoint];
+		}
+		while (index_ < index) {
+			const std::size_t frame_size = frame_size_at(pos_);
+			if (frame_size == 0) {
+				return false;
+			}
+			advance(frame_size);
+		}
+		return true;
+	}
+
+	/**
+	 * Moves to the index-th TNetstring, known to start at offset, e.g. from a Frame_index
+	 *
+	 * @param index index of the TNetstring
+	 * @param offset offset of the TNetstring from the beginning of the file
+	 */
+	void seek(std::size_t index, std::size_t offset) {
+		index_ = index;
+		pos_ = std::min(offset, size_);
+	}
+
+	/** Moves back to the first TNetstring */
+	void rewind() {
+		pos_ = 0;
+		index_ = 0;
+	}
+
+	/** Index of the next TNetstring */
+	std::size_t index() const {
+		return index_;
+	}
+
+	/** Offset of the next TNetstring from the beginning of the file */
+	std::size_t position() const {
+		return pos_;
+	}
+
+	/** Count of bytes not yet consumed, those of a trailing incomplete TNetstring at the end */
+	std::size_t remaining() const {
+		return size_ - pos_;
+	}
+
+	/** Beginning of the mapping, nullptr for empty files */
+	const char* data() const {
+		return data_;
+	}
+
+	/** Size of the file */
+	std::size_t size() const {
+		return size_;
+	}
+
+private:
+
+	/** Beginning of the mapping */
+	const char* data_;
+
+	/** Size of the mapping */
+	std::size_t size_;
+
+	/** Offset of the next TNetstring */
+	std::size_t pos_;
+
+	/** Index of the next TNetstring */
+	std::size_t index_;
+
+	/** Offsets of every SEEK_STRIDE-th TNetstring visited so far */
+	std::vector<std::size_t> offsets_;
+
+	/**
+	 * Size of the complete TNetstring at offset
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return size of the TNetstring, 0 at the end or if it is incomplete
+	 */
+	std::size_t frame_size_at(std::size_t offset) const {
+		if (offset == size_) {
+			return 0;
+		}
+		try {
+			return complete_frame_size(data_ + offset, data_ + size_);
+		} catch (boost::exception& e) {
+			e << Offset_info(offset);
+			throw;
+		}
+	}
+
+	/** Moves behind the TNetstring at the cursor, remembering offsets for seek() */
+	void advance(std::size_t frame_size) {
+		pos_ += frame_size;
+		index_++;
+		if (index_ % SEEK_STRIDE == 0 && index_ / SEEK_STRIDE == offsets_.size()) {
+			offsets_.push_back(pos_);
+		}
+	}
+
+};
+
+} // ::tnetstring
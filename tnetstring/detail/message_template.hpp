@@ -0,0 +1,439 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+
+namespace tnetstring {
+
+class Template_builder;
+
+/**
+ * Pre-encoded message template.
+ * Holds the constant bytes of a message, e.g. a heartbeat or an ack, encoded
+ * once by a Template_builder, plus slots for the variable fields. Rendering
+ * copies the constant bytes and writes the slot values and the size fields
+ * of the enclosing lists and dicts, which are the only bytes depending on the
+ * slot values. Slots are numbered in the order they were added.
+ *
+ * A template keeps the values of its slots between renderings, use one
+ * template per thread.
+ */
+class Message_template {
+public:
+
+	/** DTOR */
+	virtual ~Message_template() {};
+
+	/** Count of slots */
+	std::size_t slot_count() const {
+		return slots_.size();
+	}
+
+	/**
+	 * Sets an integer slot, to a value of any integer type
+	 *
+	 * @throw std::out_of_range, tnetstring::Type_exception if the slot is no integer slot
+	 */
+	template <typename Integer>
+	typename std::enable_if<std::is_integral<Integer>::value && !std::is_same<Integer, bool>::value>::type
+	set(std::size_t slot, Integer value) {
+		Slot& s = slot_of(slot, TNETSTRING_TAG_INT);
+		if (std::is_signed<Integer>::value) {
+			s.size = format_int64(static_cast<std::int64_t>(value), s.scratch);
+		} else {
+			s.size = format_uint64(static_cast<std::uint64_t>(value), s.scratch);
+		}
+		s.data = nullptr;
+	}
+
+	/**
+	 * Sets a float slot
+	 *
+	 * @throw std::out_of_range, tnetstring::Type_exception if the slot is no float slot
+	 */
+	void set(std::size_t slot, double value) {
+		Slot& s = slot_of(slot, TNETSTRING_TAG_FLOAT);
+		s.size = format_double(value, s.scratch);
+		s.data = nullptr;
+	}
+
+	/**
+	 * Sets a boolean slot
+	 *
+	 * @throw std::out_of_range, tnetstring::Type_exception if the slot is no boolean slot
+	 */
+	void set(std::size_t slot, bool value) {
+		Slot& s = slot_of(slot, TNETSTRING_TAG_BOOLEAN);
+		s.data = value ? "true" : "false";
+		s.size = value ? 4 : 5;
+	}
+
+	/**
+	 * Sets a string slot, the string is not copied and has to live until rendered.
+	 * Strings exceeding TNETSTRING_DATA_MAXLEN are cut like by the encoders.
+	 *
+	 * @throw std::out_of_range, tnetstring::Type_exception if the slot is no string slot
+	 */
+	void set(std::size_t slot, boost::string_view value) {
+		Slot& s = slot_of(slot, TNETSTRING_TAG_STRING);
+		s.data = value.data();
+		s.size = std::min<std::size_t>(value.size(), TNETSTRING_DATA_MAXLEN);
+	}
+
+	/** @see set(std::size_t, boost::string_view) */
+	void set(std::size_t slot, const char* value) {
+		set(slot, boost::string_view(value));
+	}
+
+	/** @see set(std::size_t, boost::string_view) */
+	void set(std::size_t slot, const std::string& value) {
+		set(slot, boost::string_view(value));
+	}
+
+	/**
+	 * Renders the message into the caller supplied buffer without any heap allocation
+	 *
+	 * @throw tnetstring::Parse_exception if the payload of a list or dict exceeds TNETSTRING_DATA_MAXLEN
+	 * @return count of bytes written, or the required size if capacity is too small
+	 */
+	Encode_result render(char* buffer, std::size_t capacity) {
+		Encode_result result;
+		result.size = compute_sizes();
+		result.ok = (result.size <= capacity);
+		if (result.ok) {
+			write(buffer);
+		}
+		return result;
+	}
+
+	/**
+	 * Renders the message into a buffer owned by the template
+	 *
+	 * @throw tnetstring::Parse_exception if the payload of a list or dict exceeds TNETSTRING_DATA_MAXLEN
+	 * @return rendered TNetstring, valid until the next call to render()
+	 */
+	boost::string_view render() {
+		const std::size_t size = compute_sizes();
+		if (buffer_.size() < size) {
+			buffer_.resize(size);
+		}
+		write(buffer_.data());
+		return boost::string_view(buffer_.data(), size);
+	}
+
+private:
+
+	friend class Template_builder;
+
+	/** Step of rendering */
+	struct Op {
+		enum Kind {COPY, SIZE, SLOT} kind;
+
+		/** Offset into bytes_ for COPY, container index for SIZE, slot index for SLOT */
+		std::size_t index;
+
+		/** Count of bytes for COPY */
+		std::size_t size;
+	};
+
+	/** Variable field */
+	struct Slot {
+		char tag;
+
+		/** Container holding the slot, 0 for the top level */
+		std::size_t parent;
+
+		/** Payload, nullptr if the payload is held in scratch */
+		const char* data;
+		std::size_t size;
+
+		/** Formatted number */
+		char scratch[DOUBLE_FORMAT_MAXLEN];
+
+		const char* payload() const {
+			return data != nullptr ? data : scratch;
+		}
+
+		std::size_t encoded_size() const {
+			return digits(size) + 1 + size + 1;
+		}
+	};
+
+	/** Constant bytes */
+	std::string bytes_;
+
+	/** Steps of rendering in order */
+	std::vector<Op> ops_;
+
+	std::vector<Slot> slots_;
+
+	/** Parent per container, containers are numbered from 1, index 0 is the top level */
+	std::vector<std::size_t> parents_;
+
+	/** Constant payload bytes per container, for the top level its constant bytes */
+	std::vector<std::size_t> constant_sizes_;
+
+	/** Payload bytes per container of the current rendering, for the top level the total size */
+	std::vector<std::size_t> payload_sizes_;
+
+	/** Buffer owned for render() */
+	std::vector<char> buffer_;
+
+	/** CTOR, see Template_builder */
+	Message_template() : bytes_(), ops_(), slots_(), parents_(1, 0), constant_sizes_(1, 0),
+			payload_sizes_(), buffer_() {};
+
+	/**
+	 * Slot to set
+	 *
+	 * @throw std::out_of_range, tnetstring::Type_exception
+	 */
+	Slot& slot_of(std::size_t slot, char tag) {
+		if (slot >= slots_.size()) {
+			throw std::out_of_range("Message_template::set");
+		}
+		if (slots_[slot].tag != tag) {
+			Type_exception e;
+			e << Error_msg_info("Template slot has another type");
+			e << Parse_char_info(slots_[slot].tag);
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return slots_[slot];
+	}
+
+	/** Count of decimal digits of value */
+	static std::size_t digits(std::size_t value) {
+		std::size_t count = 1;
+		for (; value >= 10; value /= 10) {
+			count++;
+		}
+		return count;
+	}
+
+	/**
+	 * Computes the payload sizes of the containers from the slot values
+	 *
+	 * @throw tnetstring::Parse_exception if the payload of a list or dict exceeds TNETSTRING_DATA_MAXLEN
+	 * @return total size of the message
+	 */
+	std::size_t compute_sizes() {
+		payload_sizes_ = constant_sizes_;
+		for (const Slot& slot : slots_) {
+			payload_sizes_[slot.parent] += slot.encoded_size();
+		}
+		// nested containers are numbered after their parents
+		for (std::size_t i = payload_sizes_.size() - 1; i > 0; i--) {
+			// the constant bytes cannot be cut like by the encoders, such messages are rejected
+			if (payload_sizes_[i] > static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN)) {
+				Parse_exception e;
+				e << Error_msg_info("Template container exceeds the maximum TNetstring size");
+				BOOST_THROW_EXCEPTION(e);
+			}
+			payload_sizes_[parents_[i]] += digits(payload_sizes_[i]) + 1 + payload_sizes_[i];
+		}
+		return payload_sizes_[0];
+	}
+
+	/** Writes the message, the buffer has the size computed by compute_sizes() */
+	void write(char* out) const {
+		for (const Op& op : ops_) {
+			switch (op.kind) {
+				case Op::COPY:
+					std::memcpy(out, bytes_.data() + op.index, op.size);
+					out += op.size;
+					break;
+
+				case Op::SIZE:
+					out += format_uint64(payload_sizes_[op.index], out);
+					*out++ = TNETSTRING_SIZE_DELIM;
+					break;
+
+				case Op::SLOT: {
+					const Slot& slot = slots_[op.index];
+					out += format_uint64(slot.size, out);
+					*out++ = TNETSTRING_SIZE_DELIM;
+					std::memcpy(out, slot.payload(), slot.size);
+					out += slot.size;
+					*out++ = slot.tag;
+				}; break;
+			}
+		}
+	}
+
+};
+
+/**
+ * Builder of Message_templates.
+ * Constant values are encoded while building, slots are added for the
+ * variable fields. Dict elements are added as key followed by a value,
+ * a slot or a nested container.
+ */
+class Template_builder {
+public:
+
+	/** CTOR */
+	Template_builder() : template_(), open_() {};
+
+	/** DTOR */
+	virtual ~Template_builder() {};
+
+	/** Adds a constant value */
+	Template_builder& value(const TNetstring_value& value) {
+		Buffer_encoder encoder;
+		const boost::string_view encoded = encoder.encode(value);
+		copy(encoded.data(), encoded.size());
+		return *this;
+	}
+
+	/** Adds a constant dict key */
+	Template_builder& key(boost::string_view key) {
+		const std::string size = std::to_string(key.size()) + TNETSTRING_SIZE_DELIM;
+		copy(size.data(), size.size());
+		copy(key.data(), key.size());
+		copy(&TNETSTRING_TAG_STRING, 1);
+		return *this;
+	}
+
+	/**
+	 * Adds a slot of type tag, set to 0, 0.0, false or the empty string until set
+	 *
+	 * @throw tnetstring::Type_exception for other types
+	 */
+	Template_builder& slot(char tag) {
+		Message_template::Slot slot;
+		slot.tag = tag;
+		slot.parent = current();
+		slot.data = nullptr;
+		switch (tag) {
+			case TNETSTRING_TAG_INT: slot.size = format_int(0, slot.scratch); break;
+			case TNETSTRING_TAG_FLOAT: slot.size = format_double(0.0, slot.scratch); break;
+			case TNETSTRING_TAG_BOOLEAN: slot.data = "false"; slot.size = 5; break;
+			case TNETSTRING_TAG_STRING: slot.data = ""; slot.size = 0; break;
+			default: {
+				Type_exception e;
+				e << Error_msg_info("Template slot type is not supported");
+				e << Parse_char_info(tag);
+				BOOST_THROW_EXCEPTION(e);
+			}
+		}
+		push_op(Message_template::Op::SLOT, template_.slots_.size(), 0);
+		template_.slots_.push_back(slot);
+		return *this;
+	}
+
+	/** Opens a list, following values are its elements */
+	Template_builder& begin_list() {
+		return begin(TNETSTRING_TAG_LIST);
+	}
+
+	/**
+	 * Closes the innermost list
+	 *
+	 * @throw tnetstring::Parse_exception if it is no list
+	 */
+	Template_builder& end_list() {
+		return end(TNETSTRING_TAG_LIST);
+	}
+
+	/** Opens a dict, following keys and values are its elements */
+	Template_builder& begin_dict() {
+		return begin(TNETSTRING_TAG_DICT);
+	}
+
+	/**
+	 * Closes the innermost dict
+	 *
+	 * @throw tnetstring::Parse_exception if it is no dict
+	 */
+	Template_builder& end_dict() {
+		return end(TNETSTRING_TAG_DICT);
+	}
+
+	/**
+	 * The built template
+	 *
+	 * @throw tnetstring::Parse_exception if a list or dict is still open
+	 */
+	Message_template build() const {
+		if (!open_.empty()) {
+			throw_builder_exception("Template has unclosed containers");
+		}
+		Message_template built = template_;
+		built.payload_sizes_ = built.constant_sizes_;
+		return built;
+	}
+
+private:
+
+	/** Template under construction */
+	Message_template template_;
+
+	/** Index and type of the open containers */
+	std::vector<std::pair<std::size_t, char> > open_;
+
+	/** Innermost open container, 0 for the top level */
+	std::size_t current() const {
+		return open_.empty() ? 0 : open_.back().first;
+	}
+
+	/** Appends a step, constant bytes are merged into the previous copy */
+	void push_op(Message_template::Op::Kind kind, std::size_t index, std::size_t size) {
+		std::vector<Message_template::Op>& ops = template_.ops_;
+		if (kind == Message_template::Op::COPY && !ops.empty() && ops.back().kind == Message_template::Op::COPY) {
+			ops.back().size += size;
+			return;
+		}
+		Message_template::Op op = {kind, index, size};
+		ops.push_back(op);
+	}
+
+	/** Appends constant bytes to the innermost container */
+	void copy(const char* bytes, std::size_t count) {
+		push_op(Message_template::Op::COPY, template_.bytes_.size(), count);
+		template_.bytes_.append(bytes, count);
+		template_.constant_sizes_[current()] += count;
+	}
+
+	Template_builder& begin(char tag) {
+		const std::size_t index = template_.parents_.size();
+		template_.parents_.push_back(current());
+		template_.constant_sizes_.push_back(0);
+		push_op(Message_template::Op::SIZE, index, 0);
+		open_.push_back(std::make_pair(index, tag));
+		return *this;
+	}
+
+	Template_builder& end(char tag) {
+		if (open_.empty() || open_.back().second != tag) {
+			throw_builder_exception("Template containers are not balanced");
+		}
+		open_.pop_back();
+		// the type belongs to the enclosing container
+		copy(&tag, 1);
+		return *this;
+	}
+
+	/** @throw tnetstring::Parse_exception */
+	static void throw_builder_exception(const std::string& error_msg) {
+		Parse_exception e;
+		e << Error_msg_info(error_msg);
+		BOOST_THROW_EXCEPTION(e);
+	}
+
+};
+
+} // ::tnetstring
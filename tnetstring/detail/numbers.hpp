@@ -0,0 +1,511 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <clocale>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TNETSTRING_SSE2_DIGITS
+#endif
+
+/*
+ * Number kernels used by the encoders and decoders, allocation-free except for
+ * parse_double() of unusually long ranges, and independent of the C locale.
+ * All of them work on plain character ranges, nothing is NUL terminated.
+ */
+
+namespace tnetstring {
+
+/** Buffer size sufficient for any formatted int */
+const int INT_FORMAT_MAXLEN = 12;
+
+/** Buffer size sufficient for any formatted 64 bit integer */
+const int INT64_FORMAT_MAXLEN = 21;
+
+/** Buffer size sufficient for any formatted double */
+const int DOUBLE_FORMAT_MAXLEN = 32;
+
+/** Two digit decimal strings of 00 to 99, used to format two digits at once */
+static const char DIGIT_PAIRS[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/**
+ * Formats an unsigned number as decimal number into buf, two digits per step
+ *
+ * @param buf large enough for all digits of value (20 bytes for any value)
+ * @return count of characters written
+ */
+inline std::size_t format_uint64(std::uint64_t value, char* buf) {
+	// count digits to write from the back
+	std::size_t len = 1;
+	for (std::uint64_t n = value; n >= 10; n /= 10) {
+		len++;
+	}
+
+	char* pos = buf + len;
+	while (value >= 100) {
+		const unsigned int pair = static_cast<unsigned int>(value % 100) * 2;
+		value /= 100;
+		*--pos = DIGIT_PAIRS[pair + 1];
+		*--pos = DIGIT_PAIRS[pair];
+	}
+	if (value >= 10) {
+		const unsigned int pair = static_cast<unsigned int>(value) * 2;
+		*--pos = DIGIT_PAIRS[pair + 1];
+		*--pos = DIGIT_PAIRS[pair];
+	} else {
+		*--pos = static_cast<char>('0' + value);
+	}
+	return len;
+}
+
+/**
+ * Formats an int as decimal number into buf, without allocating
+ *
+ * @param buf at least INT_FORMAT_MAXLEN bytes
+ * @return count of characters written
+ */
+inline std::size_t format_int(int value, char* buf) {
+	if (value < 0) {
+		// negate as unsigned to handle INT_MIN
+		buf[0] = '-';
+		return 1 + format_uint64(0u - static_cast<unsigned int>(value), buf + 1);
+	}
+	return format_uint64(static_cast<unsigned int>(value), buf);
+}
+
+/**
+ * Formats a 64 bit integer as decimal number into buf, without allocating
+ *
+ * @param buf at least INT64_FORMAT_MAXLEN bytes
+ * @return count of characters written
+ */
+inline std::size_t format_int64(std::int64_t value, char* buf) {
+	if (value < 0) {
+		// negate as unsigned to handle the minimum
+		buf[0] = '-';
+		return 1 + format_uint64(0u - static_cast<std::uint64_t>(value), buf + 1);
+	}
+	return format_uint64(static_cast<std::uint64_t>(value), buf);
+}
+
+/**
+ * Decimal point of the C locale category LC_NUMERIC, used by strtod and snprintf
+ */
+inline const char* locale_decimal_point() {
+	const char* point = std::localeconv()->decimal_point;
+	return point != nullptr && point[0] != '\0' ? point : ".";
+}
+
+/**
+ * Parses a double from a character range, independent of the LC_NUMERIC locale.
+ * Leading whitespace and trailing characters are rejected. Ranges of up to
+ * 2 * DOUBLE_FORMAT_MAXLEN - 2 characters are parsed without allocating.
+ *
+ * @return false if the range is no number
+ */
+inline bool parse_double(const char* str, std::size_t len, double& value) {
+	if (len == 0 || std::isspace(static_cast<unsigned char>(str[0]))) {
+		return false;
+	}
+
+	// strtod needs a terminated string with the decimal point of the locale,
+	// numbers of sane length are copied to the stack
+	const char* point = locale_decimal_point();
+	const std::size_t point_len = std::strlen(point);
+	char stack_buf[DOUBLE_FORMAT_MAXLEN * 2];
+	std::string heap_buf;
+	char* terminated = stack_buf;
+	if (len + point_len > sizeof(stack_buf)) {
+		heap_buf.resize(len + point_len);
+		terminated = &heap_buf[0];
+	}
+
+	std::size_t terminated_len = 0;
+	bool has_point = false;
+	for (std::size_t i = 0; i < len; i++) {
+		if (str[i] == '.') {
+			if (has_point) {
+				return false;
+			}
+			has_point = true;
+			std::memcpy(terminated + terminated_len, point, point_len);
+			terminated_len += point_len;
+		} else if (str[i] == point[0]) {
+			// the decimal point of the locale is no decimal point of a TNetstring
+			return false;
+		} else {
+			terminated[terminated_len++] = str[i];
+		}
+	}
+	terminated[terminated_len] = '\0';
+
+	char* parse_end = nullptr;
+	value = std::strtod(terminated, &parse_end);
+	return parse_end == terminated + terminated_len;
+}
+
+/**
+ * Replaces the decimal point of the locale in a double formatted by snprintf with '.'
+ *
+ * @param buf NUL terminated formatted double
+ * @return count of characters left
+ */
+inline int delocalize_double(char* buf, int len) {
+	const char* point = locale_decimal_point();
+	if (len <= 0 || (point[0] == '.' && point[1] == '\0')) {
+		return len;
+	}
+	char* found = std::strstr(buf, point);
+	if (found == nullptr) {
+		return len;
+	}
+	const std::size_t point_len = std::strlen(point);
+	*found = '.';
+	std::memmove(found + 1, found + point_len, buf + len + 1 - (found + point_len));
+	return len - static_cast<int>(point_len - 1);
+}
+
+/**
+ * Formats a double into buf with the least digits that parse back to the same value
+ *
+ * Compiled as C++17 std::to_chars is used, otherwise the shortest of the
+ * precisions 15 to 17 that round-trips is searched. The decimal point is '.'
+ * whatever the LC_NUMERIC locale.
+ *
+ * @param buf at least DOUBLE_FORMAT_MAXLEN bytes
+ * @return count of characters written
+ */
+inline std::size_t format_double(double value, char* buf) {
+#if defined(__cpp_lib_to_chars)
+	return std::to_chars(buf, buf + DOUBLE_FORMAT_MAXLEN, value).ptr - buf;
+#else
+	int len = 0;
+	if (std::isfinite(value)) {
+		for (int precision = std::numeric_limits<double>::digits10; precision < 17; precision++) {
+			len = delocalize_double(buf, std::snprintf(buf, DOUBLE_FORMAT_MAXLEN, "%.*g", precision, value));
+			double parsed;
+			if (parse_double(buf, len, parsed) && parsed == value) {
+				return len;
+			}
+		}
+	}
+	len = std::snprintf(buf, DOUBLE_FORMAT_MAXLEN, "%.17g", value);
+	return len > 0 ? delocalize_double(buf, len) : 0;
+#endif
+}
+
+/**
+ * Parses an optionally signed decimal integer into sign and magnitude,
+ * overflow checked and without allocating
+ *
+ * @return false if the range is no number or the magnitude exceeds std::uint64_t
+ */
+inline bool parse_magnitude(const char* str, std::size_t len, bool& negative, std::uint64_t& magnitude) {
+	if (len == 0) {
+		return false;
+	}
+
+	negative = (str[0] == '-');
+	std::size_t pos = (negative || str[0] == '+') ? 1 : 0;
+	if (pos == len) {
+		return false;
+	}
+
+	const std::uint64_t limit = std::numeric_limits<std::uint64_t>::max();
+	magnitude = 0;
+	for (; pos < len; pos++) {
+		const unsigned int digit = static_cast<unsigned char>(str[pos]) - '0';
+		if (digit > 9 || magnitude > (limit - digit) / 10) {
+			return false;
+		}
+		magnitude = magnitude * 10 + digit;
+	}
+	return true;
+}
+
+/**
+ * Parses an optionally signed decimal int, overflow checked and without allocating
+ *
+ * @return false if the range is no number or out of range
+ */
+inline bool parse_int(const char* str, std::size_t len, int& value) {
+	bool negative;
+	std::uint64_t magnitude;
+	if (!parse_magnitude(str, len, negative, magnitude)) {
+		return false;
+	}
+
+	// the limit for negative numbers is one larger
+	const std::uint64_t limit = negative
+			? 0u - static_cast<unsigned int>(std::numeric_limits<int>::min())
+			: static_cast<unsigned int>(std::numeric_limits<int>::max());
+	if (magnitude > limit) {
+		return false;
+	}
+
+	value = negative ? static_cast<int>(0u - static_cast<unsigned int>(magnitude)) : static_cast<int>(magnitude);
+	return true;
+}
+
+/**
+ * Parses an optionally signed decimal 64 bit integer, overflow checked and without allocating
+ *
+ * @return false if the range is no number or out of range
+ */
+inline bool parse_int64(const char* str, std::size_t len, std::int64_t& value) {
+	bool negative;
+	std::uint64_t magnitude;
+	if (!parse_magnitude(str, len, negative, magnitude)) {
+		return false;
+	}
+
+	// the limit for negative numbers is one larger
+	const std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + (negative ? 1 : 0);
+	if (magnitude > limit) {
+		return false;
+	}
+
+	value = negative ? static_cast<std::int64_t>(0u - magnitude) : static_cast<std::int64_t>(magnitude);
+	return true;
+}
+
+/**
+ * Parses an unsigned decimal 64 bit integer, overflow checked and without allocating
+ *
+ * @return false if the range is no number, negative or out of range
+ */
+inline bool parse_uint64(const char* str, std::size_t len, std::uint64_t& value) {
+	bool negative;
+	if (!parse_magnitude(str, len, negative, value)) {
+		return false;
+	}
+	return !negative || value == 0;
+}
+
+/**
+ * Parses an optionally signed decimal integer into the integer type selected by mode,
+ * value is a TNetstring_value or Arena_value,
+ * overflow checked and without allocating
+ *
+ * @return false if the range is no number or exceeds std::int64_t / std::uint64_t
+ */
+template <typename Value>
+inline bool parse_integer(const char* str, std::size_t len, Int_mode mode, Value& value) {
+	bool negative;
+	std::uint64_t magnitude;
+	if (!parse_magnitude(str, len, negative, magnitude)) {
+		return false;
+	}
+
+	const std::uint64_t int64_max = std::numeric_limits<std::int64_t>::max();
+
+	if (negative) {
+		if (magnitude > int64_max + 1) {
+			return false;
+		}
+		const std::int64_t int64_val = static_cast<std::int64_t>(0u - magnitude);
+		if (mode == INT_NARROWEST && int64_val >= std::numeric_limits<int>::min()) {
+			value = static_cast<int>(int64_val);
+		} else {
+			value = int64_val;
+		}
+
+	} else {
+		if (mode == INT_NARROWEST && magnitude <= static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+			value = static_cast<int>(magnitude);
+		} else if (magnitude <= int64_max) {
+			value = static_cast<std::int64_t>(magnitude);
+		} else {
+			value = magnitude;
+		}
+	}
+	return true;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && defined(__GNUC__)
+#define TNETSTRING_SWAR_DIGITS
+#endif
+
+#ifdef TNETSTRING_SWAR_DIGITS
+/**
+ * Converts eight ASCII digits loaded into a little endian word, SWAR style.
+ * Bytes which are zero count as leading zeros.
+ */
+inline std::uint32_t swar_eight_digits(std::uint64_t chunk) {
+	chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+	chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+	return static_cast<std::uint32_t>(((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+/**
+ * Marks the bytes of a little endian word which are no ASCII digits with non-zero bytes.
+ * Bytes behind the first non-digit may be marked wrongly.
+ */
+inline std::uint64_t swar_non_digits(std::uint64_t chunk) {
+	const std::uint64_t high_nibbles = chunk & 0xF0F0F0F0F0F0F0F0ULL;
+	const std::uint64_t overflow_nibbles = ((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4;
+	return (high_nibbles | overflow_nibbles) ^ 0x3333333333333333ULL;
+}
+#endif
+
+/**
+ * Count of leading ASCII digits of the range [str, end).
+ * Sixteen characters are classified at once with SSE2 where available.
+ */
+inline std::size_t leading_digits(const char* str, const char* end) {
+	const char* pos = str;
+
+#ifdef TNETSTRING_SSE2_DIGITS
+	const __m128i below = _mm_set1_epi8('0');
+	const __m128i above = _mm_set1_epi8('9');
+	while (end - pos >= 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+		// signed compares, bytes of 0x80 and above are negative and thus below '0'
+		const __m128i non_digits = _mm_or_si128(_mm_cmplt_epi8(chunk, below), _mm_cmpgt_epi8(chunk, above));
+		const int mask = _mm_movemask_epi8(non_digits);
+		if (mask != 0) {
+			return (pos - str) + __builtin_ctz(mask);
+		}
+		pos += 16;
+	}
+#endif
+
+	while (pos != end && *pos >= '0' && *pos <= '9') {
+		pos++;
+	}
+	return pos - str;
+}
+
+/**
+ * Parses a well formed size field (1 to TNETSTRING_SIZE_MAXLEN digits and the delimiter).
+ * Up to eight digits are converted at once where possible. Callers produce their
+ * diagnostics with a scalar scan if the size field is not well formed.
+ *
+ * @param str first character of the size field
+ * @param end end of the available characters
+ * @param size parsed size
+ * @return count of digits, 0 if the size field is not well formed
+ */
+inline std::size_t parse_size(const char* str, const char* end, std::size_t& size) {
+	const std::size_t available = end - str;
+
+#ifdef TNETSTRING_SWAR_DIGITS
+	if (available >= 8) {
+		std::uint64_t chunk;
+		std::memcpy(&chunk, str, 8);
+		const std::uint64_t non_digits = swar_non_digits(chunk);
+
+		if (non_digits == 0) {
+			// eight digits, a ninth digit may follow before the delimiter
+			std::size_t value = swar_eight_digits(chunk);
+			std::size_t digits = 8;
+			if (digits < available && str[digits] >= '0' && str[digits] <= '9') {
+				value = value * 10 + (str[digits] - '0');
+				digits++;
+			}
+			if (digits < available && str[digits] == TNETSTRING_SIZE_DELIM) {
+				size = value;
+				return digits;
+			}
+			return 0;
+		}
+
+		const std::size_t digits = __builtin_ctzll(non_digits) / 8;
+		if (digits == 0 || str[digits] != TNETSTRING_SIZE_DELIM) {
+			return 0;
+		}
+		// shift the digits to the most significant end, the zero bytes become leading zeros
+		size = swar_eight_digits(chunk << (8 * (8 - digits)));
+		return digits;
+	}
+#endif
+
+	std::size_t value = 0;
+	std::size_t digits = 0;
+	for (; digits < available && digits <= static_cast<std::size_t>(TNETSTRING_SIZE_MAXLEN); digits++) {
+		const char c = str[digits];
+		if (c == TNETSTRING_SIZE_DELIM) {
+			if (digits == 0) {
+				return 0;
+			}
+			size = value;
+			return digits;
+		} else if (c < '0' || c > '9') {
+			return 0;
+		}
+		value = value * 10 + (c - '0');
+	}
+	return 0;
+}
+
+/**
+ * Utility methode to create new exceptions and fill them with
+ * default error_info data.
+ */
+inline Parse_exception create_parse_exception(const std::string& error_msg) {
+	Parse_exception e = Parse_exception();
+	e << Error_msg_info(error_msg);
+	return e;
+}
+
+/**
+ * Scans a size field rejected by parse_size() again to throw a detailed exception
+ *
+ * @throw tnetstring::Parse_exception
+ * @param str first character of the size field
+ * @param end end of the available characters
+ */
+inline void throw_size_exception(const char* str, const char* end) {
+	for (int size_length = 0;; size_length++) {
+		// check for premature end of buffer
+		if (str + size_length == end) {
+			Parse_exception e = create_parse_exception("Premature end of TNetstring");
+			e << Parse_pos_info(size_length);
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		const char c = str[size_length];
+
+		if (c == TNETSTRING_SIZE_DELIM) {
+			// an empty size field is no integer
+			Parse_exception e = create_parse_exception("TNetstring size field is not an integer.");
+			e << Parse_pos_info(size_length);
+			BOOST_THROW_EXCEPTION(e);
+
+		// check for maximum size length
+		} else if (size_length == TNETSTRING_SIZE_MAXLEN) {
+			Parse_exception e = create_parse_exception("TNetstring size field is too large");
+			e << Parse_pos_info(size_length);
+			BOOST_THROW_EXCEPTION(e);
+
+		// check whether character is numeric
+		} else if (c < '0' || c > '9') {
+			Parse_exception e = create_parse_exception("TNetstring size field is not a digit");
+			e << Parse_pos_info(size_length);
+			e << Parse_char_info(c);
+			BOOST_THROW_EXCEPTION(e);
+		}
+	}
+}
+
+} // ::tnetstring
@@ -0,0 +1,95 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace tnetstring {
+
+/**
+ * Default count of threads for parallel decoding, the count of hardware threads
+ */
+inline unsigned default_thread_count() {
+	const unsigned count = std::thread::hardware_concurrency();
+	return count != 0 ? count : 1;
+}
+
+/**
+ * Calls f(i) for every i of [0, count) on up to threads threads, the calling
+ * thread included. Indices are claimed in chunks from a shared counter, so
+ * threads finishing early take over the remaining work.
+ *
+ * The first exception thrown by f stops the remaining work and is rethrown
+ * once all the threads are joined.
+ */
+template <typename F>
+void parallel_for(std::size_t count, unsigned threads, F f) {
+	threads = static_cast<unsigned>(std::min<std::size_t>(std::max(threads, 1u), count));
+	if (threads <= 1) {
+		for (std::size_t i = 0; i < count; i++) {
+			f(i);
+		}
+		return;
+	}
+
+	// some chunks per thread to balance unevenly sized work
+	const std::size_t chunk = std::max<std::size_t>(1, count / (threads * 16));
+	std::atomic<std::size_t> next(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		try {
+			for (;;) {
+				const std::size_t begin = next.fetch_add(chunk);
+				if (begin >= count || failed) {
+					return;
+				}
+				const std::size_t end = std::min(begin + chunk, count);
+				for (std::size_t i = begin; i < end; i++) {
+					f(i);
+				}
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			failed = true;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (unsigned i = 1; i < threads; i++) {
+		try {
+			workers.emplace_back(work);
+		} catch (const std::system_error&) {
+			// out of threads, the started ones share the work
+			break;
+		}
+	}
+	work();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+} // ::tnetstring
@@ -0,0 +1,228 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace tnetstring {
+
+/** Default payload size above which containers are decoded in parallel */
+const std::size_t PARALLEL_DECODE_THRESHOLD = 1 << 20;
+
+/**
+ * Parallel decoder.
+ * Decodes a single large TNetstring, e.g. a snapshot made of one huge list or dict,
+ * on several threads. The elements of containers above a size threshold are located
+ * by their size fields without decoding them and are then decoded concurrently.
+ * Containers among those elements are split up as well, down to a count of levels.
+ *
+ * The result is identical to Buffer_decoder's. Malformed TNetstrings are decoded
+ * again serially, so the thrown exception is identical as well.
+ */
+class Parallel_decoder {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param data buffer to decode from
+	 * @param size size of the buffer
+	 * @param threads count of threads, the calling thread included
+	 * @param levels count of container levels split up, 1 for the top-level container only
+	 * @param threshold payload size above which containers are split up
+	 * @param int_mode type integers are decoded to
+	 */
+	Parallel_decoder(const char* data, std::size_t size, unsigned threads = default_thread_count(), int levels = 1,
+	                 std::size_t threshold = PARALLEL_DECODE_THRESHOLD, Int_mode int_mode = INT_NARROWEST)
+		: data_(data), end_(data + size), threads_(threads), levels_(levels), threshold_(threshold),
+		  int_mode_(int_mode), tasks_(), duplicates_() {};
+
+	/** DTOR */
+	virtual ~Parallel_decoder() {};
+
+	/**
+	 * Decodes the TNetstring at the beginning of the buffer
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param value future decoded TNetstring_value
+	 * @return count of bytes consumed from the buffer
+	 */
+	std::size_t decode(TNetstring_value& value) {
+		tasks_.clear();
+		duplicates_.clear();
+
+		try {
+
+			const std::size_t frame_size = plan(data_, end_, value, levels_);
+			if (frame_size != 0) {
+				parallel_for(tasks_.size(), threads_, [this](std::size_t i) {
+					Buffer_decoder decoder(tasks_[i].frame, tasks_[i].size, int_mode_);
+					decoder.decode(*tasks_[i].value);
+				});
+				duplicates_.clear();
+				return frame_size;
+			}
+
+		} catch (Parse_exception&) {
+			// decoded again below for the exact exception
+		}
+
+		Buffer_decoder decoder(data_, end_ - data_, int_mode_);
+		return decoder.decode(value);
+	}
+
+private:
+
+	/** TNetstring to be decoded by one of the threads */
+	struct Task {
+		TNetstring_value* value;
+		const char* frame;
+		std::size_t size;
+	};
+
+	/** Beginning of the buffer */
+	const char* data_;
+
+	/** End of the buffer (one past the last character) */
+	const char* end_;
+
+	/** Count of threads */
+	unsigned threads_;
+
+	/** Count of container levels split up */
+	int levels_;
+
+	/** Payload size above which containers are split up */
+	std::size_t threshold_;
+
+	/** Type integers are decoded to */
+	Int_mode int_mode_;
+
+	/** TNetstrings to be decoded */
+	std::vector<Task> tasks_;
+
+	/** Values of duplicate dict keys, decoded for their errors only like Buffer_decoder does */
+	std::deque<TNetstring_value> duplicates_;
+
+	/**
+	 * Plans the decoding of the TNetstring at pos into value. Containers above the
+	 * threshold are created and split up into their elements, everything else
+	 * becomes a task.
+	 *
+	 * @param end end of the enclosing container, or of the buffer
+	 * @param levels count of container levels still to be split up
+	 * @return size of the TNetstring, 0 if it is malformed
+	 */
+	std::size_t plan(const char* pos, const char* end, TNetstring_value& value, int levels) {
+		std::size_t size;
+		const std::size_t size_length = parse_size(pos, end, size);
+		const char* payload = pos + size_length + 1;
+		if (size_length == 0 || static_cast<std::size_t>(end - payload) <= size) {
+			return 0;
+		}
+		const char* payload_end = payload + size;
+		const char tag = *payload_end;
+		const std::size_t frame_size = payload_end + 1 - pos;
+
+		if (levels <= 0 || size < threshold_ || (tag != TNETSTRING_TAG_LIST && tag != TNETSTRING_TAG_DICT)) {
+			Task task = {&value, pos, frame_size};
+			tasks_.push_back(task);
+			return frame_size;
+		}
+
+		if (tag == TNETSTRING_TAG_LIST) {
+			// count the elements first, the list must not reallocate once planned
+			std::size_t count = 0;
+			for (const char* element = payload; element < payload_end; count++) {
+				const std::size_t element_size = skip(element, payload_end);
+				if (element_size == 0) {
+					return 0;
+				}
+				element += element_size;
+			}
+
+			value = TNetstring_list(count);
+			TNetstring_list& list = boost::get<TNetstring_list>(value);
+			const char* element = payload;
+			for (TNetstring_value& element_value : list) {
+				const std::size_t element_size = plan(element, payload_end, element_value, levels - 1);
+				if (element_size == 0) {
+					return 0;
+				}
+				element += element_size;
+			}
+
+		} else {
+			value = TNetstring_dict();
+			TNetstring_dict& dict = boost::get<TNetstring_dict>(value);
+			for (const char* element = payload; element < payload_end;) {
+				// KEY, decoded right away
+				const std::size_t key_size = skip(element, payload_end);
+				if (key_size == 0 || element[key_size - 1] != TNETSTRING_TAG_STRING) {
+					return 0;
+				}
+				const char* key = element + parse_size(element, payload_end, size) + 1;
+				element += key_size;
+				if (element == payload_end) {
+					return 0;
+				}
+
+				// VALUE, a duplicate key keeps the first value
+				std::pair<TNetstring_dict::iterator, bool> inserted =
+						dict.emplace(std::string(key, size), TNetstring_value());
+				if (!inserted.second) {
+					duplicates_.emplace_back();
+				}
+				TNetstring_value& element_value = inserted.second ? inserted.first->second : duplicates_.back();
+				const std::size_t value_size = plan(element, payload_end, element_value, levels - 1);
+				if (value_size == 0) {
+					return 0;
+				}
+				element += value_size;
+			}
+		}
+		return frame_size;
+	}
+
+	/**
+	 * Size of the TNetstring at pos, located by its size field only
+	 *
+	 * @return size of the TNetstring, 0 if it is malformed
+	 */
+	static std::size_t skip(const char* pos, const char* end) {
+		std::size_t size;
+		const std::size_t size_length = parse_size(pos, end, size);
+		const char* payload = pos + size_length + 1;
+		if (size_length == 0 || static_cast<std::size_t>(end - payload) <= size) {
+			return 0;
+		}
+		return size_length + 1 + size + 1;
+	}
+
+};
+
+/**
+ * Decodes the TNetstring at the beginning of the buffer, splitting up large containers
+ * across threads, see Parallel_decoder
+ *
+ * @throw tnetstring::Parse_exception
+ * @return count of bytes consumed from the buffer
+ */
+inline std::size_t decode_parallel(const char* data, std::size_t size, TNetstring_value& value,
+                                   unsigned threads = default_thread_count(), int levels = 1,
+                                   std::size_t threshold = PARALLEL_DECODE_THRESHOLD,
+                                   Int_mode int_mode = INT_NARROWEST) {
+	Parallel_decoder decoder(data, size, threads, levels, threshold, int_mode);
+	return decoder.decode(value);
+}
+
+} // ::tnetstring
@@ -0,0 +1,262 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+
+namespace tnetstring {
+
+/**
+ * Event parser.
+ * Parses TNetstrings from a contiguous memory buffer and reports every value
+ * to a handler instead of building a TNetstring_value tree. The handler is a
+ * template parameter, so its callbacks can be inlined.
+ *
+ * The handler has to provide:
+ *
+ *     void on_null();
+ *     void on_bool(bool value);
+ *     void on_int(std::int64_t value);
+ *     void on_uint(std::uint64_t value);      // integers beyond std::int64_t
+ *     void on_double(double value);
+ *     void on_string(boost::string_view value);
+ *     void begin_list();
+ *     void end_list();
+ *     void begin_dict();
+ *     void key(boost::string_view key);
+ *     void end_dict();
+ *
+ * Strings and keys point into the buffer, which has to outlive the parser.
+ * Exceptions thrown by the handler abort parsing.
+ */
+template <typename Handler>
+class Parser {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param data buffer to parse
+	 * @param size size of the buffer
+	 * @param handler receives the parsed values
+	 */
+	Parser(const char* data, std::size_t size, Handler& handler)
+		: begin_(data), pos_(data), end_(data + size), handler_(handler) {};
+
+	/** DTOR */
+	virtual ~Parser() {};
+
+	/**
+	 * Parses the TNetstring at the cursor
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return count of bytes consumed from the buffer
+	 */
+	std::size_t parse() {
+		const char* start = pos_;
+		parse_element(end_, false);
+		return pos_ - start;
+	}
+
+	/** Offset of the cursor from the beginning of the buffer */
+	std::size_t position() const {
+		return pos_ - begin_;
+	}
+
+	/** Count of bytes not yet consumed */
+	std::size_t remaining() const {
+		return end_ - pos_;
+	}
+
+private:
+
+	/** Beginning of the buffer */
+	const char* begin_;
+
+	/** Cursor, all the methods read from here */
+	const char* pos_;
+
+	/** End of the buffer (one past the last character) */
+	const char* end_;
+
+	/** Receives the parsed values */
+	Handler& handler_;
+
+	/**
+	 * Parses the TNetstring at the cursor and reports it to the handler
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param container_end end of the payload of the enclosing container, or of the buffer
+	 * @param nested whether the TNetstring is an element of a container
+	 */
+	void parse_element(const char* container_end, bool nested) {
+		const std::size_t size = parse_element_size(container_end, nested);
+
+		const char* payload = pos_;
+		const char tag = payload[size];
+
+		switch (tag) {
+			case TNETSTRING_TAG_STRING: {
+				handler_.on_string(boost::string_view(payload, size));
+			}; break;
+
+			case TNETSTRING_TAG_INT: {
+				std::int64_t int_val;
+				std::uint64_t uint_val;
+				if (parse_int64(payload, size, int_val)) {
+					handler_.on_int(int_val);
+				} else if (parse_uint64(payload, size, uint_val)) {
+					handler_.on_uint(uint_val);
+				} else {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int");
+					e << Parse_value_info(std::string(payload, size));
+					BOOST_THROW_EXCEPTION(e);
+				}
+			}; break;
+
+			case TNETSTRING_TAG_FLOAT: {
+				double double_val;
+				if (!parse_double(payload, size, double_val)) {
+					Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to double");
+					e << Parse_value_info(std::string(payload, size));
+					BOOST_THROW_EXCEPTION(e);
+				}
+				handler_.on_double(double_val);
+			}; break;
+
+			case TNETSTRING_TAG_BOOLEAN: {
+				handler_.on_bool(size == 4 && std::memcmp(payload, "true", 4) == 0);
+			}; break;
+
+			case TNETSTRING_TAG_NULL: {
+				handler_.on_null();
+			}; break;
+
+			case TNETSTRING_TAG_DICT: {
+				handler_.begin_dict();
+				parse_dict(payload + size);
+				handler_.end_dict();
+			}; break;
+
+			case TNETSTRING_TAG_LIST: {
+				handler_.begin_list();
+				parse_list(payload + size);
+				handler_.end_list();
+			}; break;
+
+			default:
+				// -> illegal netstring.
+				Parse_exception e =
+						create_parse_exception("Illegal or unsupported TNetstring payload type");
+				e << Parse_char_info(tag);
+				BOOST_THROW_EXCEPTION(e);
+		}
+
+		// consume payload and type character
+		pos_ = payload + size + 1;
+	}
+
+	/**
+	 * Parses and consumes the size field at the cursor like Buffer_decoder,
+	 * then checks the payload and type character fit into the container
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param container_end end of the payload of the enclosing container, or of the buffer
+	 * @param nested whether the TNetstring is an element of a container
+	 * @return size of the payload
+	 */
+	std::size_t parse_element_size(const char* container_end, bool nested) {
+		std::size_t size;
+		const std::size_t size_length = parse_size(pos_, end_, size);
+		if (size_length == 0) {
+			throw_size_exception(pos_, end_);
+		}
+		pos_ += size_length + 1;
+
+		if (container_end - pos_ <= static_cast<std::ptrdiff_t>(size)) {
+			if (nested) {
+				Parse_exception e = create_parse_exception("TNetstring element exceeds its container");
+				e << Size_info(static_cast<int>(size));
+				BOOST_THROW_EXCEPTION(e);
+			}
+			Parse_exception e = create_parse_exception("Premature end of TNetstring");
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return size;
+	}
+
+	/**
+	 * (Recursively) parses the elements of a list payload
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param container_end end of the list payload
+	 */
+	void parse_list(const char* container_end) {
+		try {
+
+			while (pos_ < container_end) {
+				parse_element(container_end, true);
+			}
+
+		} catch (boost::exception& e) {
+			e << Count_info(container_end - pos_);
+			throw;
+		}
+	}
+
+	/**
+	 * (Recursively) parses the keys and values of a dict payload
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @param container_end end of the dict payload
+	 */
+	void parse_dict(const char* container_end) {
+		try {
+
+			while (pos_ < container_end) {
+				// KEY
+				const std::size_t size = parse_element_size(container_end, true);
+				const char* key = pos_;
+
+				// only strings are allowed as key
+				if (key[size] != TNETSTRING_TAG_STRING) {
+					Parse_exception e = create_parse_exception("dict key must be of type string");
+					BOOST_THROW_EXCEPTION(e);
+				}
+				handler_.key(boost::string_view(key, size));
+				pos_ = key + size + 1;
+
+				// VALUE
+				parse_element(container_end, true);
+			}
+
+		} catch (boost::exception& e) {
+			e << Count_info(container_end - pos_);
+			throw;
+		}
+	}
+
+};
+
+/**
+ * Parses the TNetstring at the beginning of the buffer and reports it to handler
+ *
+ * @throw tnetstring::Parse_exception
+ * @return count of bytes consumed from the buffer
+ */
+template <typename Handler>
+inline std::size_t parse(const char* data, std::size_t size, Handler& handler) {
+	Parser<Handler> parser(data, size, handler);
+	return parser.parse();
+}
+
+} // ::tnetstring
@@ -0,0 +1,176 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace tnetstring {
+
+/**
+ * Compiled path query.
+ * A path like "header.route.shard" or "items[3].price" names a value nested in
+ * dicts (by key) and lists (by index). The path is parsed once and can then be
+ * evaluated against any number of encoded TNetstrings. Evaluation only walks the
+ * size fields of the containers along the path, see View.
+ */
+class Path {
+public:
+
+	/**
+	 * CTOR, compiles the path
+	 *
+	 * @throw tnetstring::Parse_exception, tagged with the Parse_pos_info of the offending character
+	 * @param path dict keys separated by '.', list indices in brackets
+	 */
+	explicit Path(const std::string& path) : segments_() {
+		compile(path);
+	};
+
+	/** DTOR */
+	virtual ~Path() {};
+
+	/**
+	 * Looks up the value named by the path
+	 *
+	 * @throw tnetstring::Type_exception if a value along the path is no dict or list as named,
+	 *        tnetstring::Parse_exception
+	 * @return view of the value or an invalid view if a key or index does not exist
+	 */
+	View evaluate(const View& root) const {
+		View current = root;
+		for (const Segment& segment : segments_) {
+			if (segment.is_index) {
+				current = element(current, segment.index);
+			} else {
+				current = current.find(segment.key);
+			}
+			if (!current) {
+				break;
+			}
+		}
+		return current;
+	}
+
+	/**
+	 * Looks up the value named by the path in the TNetstring at the beginning of the buffer
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 * @return view of the value or an invalid view if a key or index does not exist
+	 */
+	View evaluate(const char* data, std::size_t size) const {
+		return evaluate(View(data, size));
+	}
+
+	/** Count of keys and indices of the path */
+	std::size_t length() const {
+		return segments_.size();
+	}
+
+private:
+
+	/** Dict key or list index */
+	struct Segment {
+		std::string key;
+		std::size_t index;
+		bool is_index;
+	};
+
+	/** Keys and indices from the outermost container inwards */
+	std::vector<Segment> segments_;
+
+	/**
+	 * Parses the path into segments
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	void compile(const std::string& path) {
+		std::size_t pos = 0;
+		while (pos < path.size()) {
+			Segment segment = {std::string(), 0, path[pos] == '['};
+
+			if (segment.is_index) {
+				// [digits]
+				const std::size_t digits = ++pos;
+				while (pos < path.size() && path[pos] >= '0' && path[pos] <= '9') {
+					segment.index = segment.index * 10 + (path[pos++] - '0');
+				}
+				if (pos == digits || pos == path.size() || path[pos] != ']') {
+					throw_path_exception("Path index is not an integer", pos);
+				}
+				pos++;
+
+			} else {
+				// key up to the next separator
+				if (!segments_.empty()) {
+					if (path[pos] != '.') {
+						throw_path_exception("Path segments must be separated by '.'", pos);
+					}
+					pos++;
+				}
+				const std::size_t key = pos;
+				while (pos < path.size() && path[pos] != '.' && path[pos] != '[') {
+					pos++;
+				}
+				if (pos == key) {
+					throw_path_exception("Path key is empty", pos);
+				}
+				segment.key = path.substr(key, pos - key);
+			}
+
+			segments_.push_back(segment);
+		}
+	}
+
+	/**
+	 * Element index of a list, located by the size fields of the elements before it
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 * @return view of the element or an invalid view if the list is shorter
+	 */
+	static View element(const View& list, std::size_t index) {
+		if (list.type() != TNETSTRING_TAG_LIST) {
+			Type_exception e;
+			e << Error_msg_info("TNetstring value is not a list");
+			e << Parse_char_info(list.type());
+			BOOST_THROW_EXCEPTION(e);
+		}
+		const View::const_iterator end_it = list.end();
+		View::const_iterator it = list.begin();
+		for (; it != end_it && index > 0; ++it, --index) {
+		}
+		return it != end_it ? *it : View();
+	}
+
+	/**
+	 * Throws a Parse_exception for a malformed path
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	static void throw_path_exception(const std::string& error_msg, std::size_t pos) {
+		Parse_exception e;
+		e << Error_msg_info(error_msg);
+		e << Parse_pos_info(static_cast<int>(pos));
+		BOOST_THROW_EXCEPTION(e);
+	}
+
+};
+
+/**
+ * Looks up the value named by path in the TNetstring at the beginning of the buffer,
+ * compile the Path once to look it up repeatedly
+ *
+ * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+ * @return view of the value or an invalid view if a key or index does not exist
+ */
+inline View extract(const char* data, std::size_t size, const Path& path) {
+	return path.evaluate(data, size);
+}
+
+} // ::tnetstring
@@ -0,0 +1,224 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace tnetstring {
+
+/**
+ * Push parser.
+ * Decodes TNetstrings from data arriving in arbitrary pieces, e.g. from
+ * non-blocking socket reads. feed() never throws for incomplete data, it keeps
+ * its state between calls and reports how many more bytes are needed.
+ *
+ * Every TNetstring starts with its size, so once the size field of a top-level
+ * TNetstring is complete the length of the whole frame is known. Frames lying
+ * completely within a fed piece are decoded in place, the others are collected
+ * in an internal buffer and decoded once they are complete. Every byte is
+ * therefore decoded exactly once.
+ */
+class Push_parser {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param int_mode type integers are decoded to
+	 */
+	explicit Push_parser(Int_mode int_mode = INT_NARROWEST)
+		: int_mode_(int_mode), buffer_(), frame_size_(0), values_() {};
+
+	/** DTOR */
+	virtual ~Push_parser() {};
+
+	/**
+	 * Feeds the next piece of data, completed top-level TNetstrings are
+	 * queued to be fetched by next()
+	 *
+	 * @throw tnetstring::Parse_exception if the data is no TNetstring,
+	 *        the parser has to be reset() afterwards
+	 * @param data next piece of data
+	 * @param size size of the piece
+	 * @return count of bytes at least needed to complete the next TNetstring
+	 */
+	std::size_t feed(const char* data, std::size_t size) {
+		const char* end = data + size;
+
+		while (data != end) {
+			if (buffer_.empty()) {
+				data = decode_in_place(data, end);
+			} else if (frame_size_ == 0) {
+				data = feed_size(data, end);
+			} else {
+				data = feed_payload(data, end);
+			}
+		}
+		return needed();
+	}
+
+	/** Feeds a string, see feed(const char*, std::size_t) */
+	std::size_t feed(const std::string& data) {
+		return feed(data.data(), data.size());
+	}
+
+	/**
+	 * Fetches the next completed top-level TNetstring
+	 *
+	 * @param value future decoded TNetstring_value
+	 * @return false if no TNetstring is completed
+	 */
+	bool next(TNetstring_value& value) {
+		if (values_.empty()) {
+			return false;
+		}
+		value = std::move(values_.front());
+		values_.pop_front();
+		return true;
+	}
+
+	/** Count of completed TNetstrings not yet fetched */
+	std::size_t available() const {
+		return values_.size();
+	}
+
+	/** Count of bytes at least needed to complete the next TNetstring */
+	std::size_t needed() const {
+		if (frame_size_ != 0) {
+			return frame_size_ - buffer_.size();
+		}
+		// smallest TNetstring is "0:~", a started size field needs at least delimiter and type
+		return buffer_.empty() ? 3 : 2;
+	}
+
+	/** Discards the partially fed TNetstring and the completed ones not yet fetched */
+	void reset() {
+		buffer_.clear();
+		frame_size_ = 0;
+		values_.clear();
+	}
+
+private:
+
+	/** Type integers are decoded to */
+	Int_mode int_mode_;
+
+	/** Collected bytes of the incomplete frame, starting with its size field */
+	std::vector<char> buffer_;
+
+	/** Size of the whole incomplete frame, 0 while its size field is incomplete */
+	std::size_t frame_size_;
+
+	/** Completed top-level TNetstrings */
+	std::deque<TNetstring_value> values_;
+
+	/**
+	 * Decodes the frame at data without copying if it is complete,
+	 * starts collecting it otherwise
+	 *
+	 * @return first byte not consumed
+	 */
+	const char* decode_in_place(const char* data, const char* end) {
+		std::size_t size;
+		const std::size_t size_length = parse_size(data, end, size);
+
+		// size field and delimiter, payload and type character
+		if (size_length != 0 && static_cast<std::size_t>(end - data) > size_length + 1 + size) {
+			return data + decode_frame(data, size_length + 1 + size + 1);
+		}
+		return feed_size(data, end);
+	}
+
+	/**
+	 * Collects the size field of the next frame, byte by byte
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return first byte not consumed
+	 */
+	const char* feed_size(const char* data, const char* end) {
+		for (; data != end; data++) {
+			const char c = *data;
+			const std::size_t size_length = buffer_.size();
+
+			if (c == TNETSTRING_SIZE_DELIM) {
+				if (size_length == 0) {
+					Parse_exception e = create_parse_exception("TNetstring size field is not an integer.");
+					e << Parse_pos_info(size_length);
+					BOOST_THROW_EXCEPTION(e);
+				}
+				std::size_t size = 0;
+				for (char digit : buffer_) {
+					size = size * 10 + (digit - '0');
+				}
+				buffer_.push_back(c);
+				frame_size_ = size_length + 1 + size + 1;
+				return data + 1;
+
+			// check for maximum size length
+			} else if (size_length == TNETSTRING_SIZE_MAXLEN) {
+				Parse_exception e = create_parse_exception("TNetstring size field is too large");
+				e << Parse_pos_info(size_length);
+				BOOST_THROW_EXCEPTION(e);
+
+			// check whether character is numeric
+			} else if (c < '0' || c > '9') {
+				Parse_exception e = create_parse_exception("TNetstring size field is not a digit");
+				e << Parse_pos_info(size_length);
+				e << Parse_char_info(c);
+				BOOST_THROW_EXCEPTION(e);
+			}
+
+			buffer_.push_back(c);
+		}
+		return data;
+	}
+
+	/**
+	 * Collects the payload and type character of the next frame, decodes the frame when complete
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return first byte not consumed
+	 */
+	const char* feed_payload(const char* data, const char* end) {
+		const std::size_t count = std::min<std::size_t>(end - data, frame_size_ - buffer_.size());
+		buffer_.insert(buffer_.end(), data, data + count);
+
+		if (buffer_.size() == frame_size_) {
+			decode_frame(buffer_.data(), buffer_.size());
+			buffer_.clear();
+			frame_size_ = 0;
+		}
+		return data + count;
+	}
+
+	/**
+	 * Decodes a complete frame and queues its value
+	 *
+	 * @throw tnetstring::Parse_exception
+	 * @return size of the frame
+	 */
+	std::size_t decode_frame(const char* frame, std::size_t size) {
+		Buffer_decoder decoder(frame, size, int_mode_);
+		values_.emplace_back();
+		try {
+			decoder.decode(values_.back());
+		} catch (...) {
+			values_.pop_back();
+			throw;
+		}
+		return size;
+	}
+
+};
+
+} // ::tnetstring
@@ -0,0 +1,442 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/seq/for_each_i.hpp>
+#include <boost/preprocessor/seq/reverse.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/preprocessor/variadic/to_seq.hpp>
+#include <boost/utility/string_view.hpp>
+
+
+namespace tnetstring {
+
+/** Maximum count of fields of a struct declared with TNETSTRING_FIELDS, the limit of Boost.Preprocessor sequences */
+const std::size_t TYPED_FIELDS_MAX = 256;
+
+/** Fields of a struct already decoded from a dict, by index */
+typedef std::bitset<TYPED_FIELDS_MAX> Decoded_fields;
+
+/**
+ * Typed encoder.
+ * Encodes C++ values with a Codec straight into a buffer, without building a
+ * TNetstring_value. Like Buffer_encoder the buffer is filled from the back, so
+ * the size of a list or dict is known by the time its size field is written.
+ * The buffer grows towards the front as needed and is kept between calls.
+ */
+class Typed_encoder {
+public:
+
+	/** CTOR */
+	Typed_encoder() : buffer_(), begin_(0) {};
+
+	/** DTOR */
+	virtual ~Typed_encoder() {};
+
+	/**
+	 * Encodes the value, replacing the previously encoded one
+	 *
+	 * @return encoded TNetstring, valid until the next call to encode()
+	 */
+	template <typename T>
+	boost::string_view encode(const T& value);
+
+	/** First byte of the encoded TNetstring */
+	const char* data() const {
+		return buffer_.data() + begin_;
+	}
+
+	/** Count of bytes of the encoded TNetstring */
+	std::size_t size() const {
+		return buffer_.size() - begin_;
+	}
+
+	/** Copy of the encoded TNetstring */
+	std::string str() const {
+		return std::string(data(), size());
+	}
+
+	/** Prepends a single character */
+	void prepend(char c) {
+		reserve(1);
+		buffer_[--begin_] = c;
+	}
+
+	/** Prepends count bytes */
+	void prepend(const char* bytes, std::size_t count) {
+		reserve(count);
+		begin_ -= count;
+		std::memcpy(&buffer_[begin_], bytes, count);
+	}
+
+	/** Prepends size digits and the size delimiter */
+	void prepend_size(std::size_t len) {
+		prepend(TNETSTRING_SIZE_DELIM);
+		do {
+			prepend(static_cast<char>('0' + len % 10));
+			len /= 10;
+		} while (len != 0);
+	}
+
+	/**
+	 * Prepends the size field of an already written list or dict payload.
+	 * Payloads exceeding TNETSTRING_DATA_MAXLEN are cut like the stream encoder does.
+	 */
+	void prepend_container_size(std::size_t len) {
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			const std::size_t cut = len - TNETSTRING_DATA_MAXLEN;
+			std::memmove(&buffer_[begin_ + cut], &buffer_[begin_], TNETSTRING_DATA_MAXLEN);
+			begin_ += cut;
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+		prepend_size(len);
+	}
+
+	/** Prepends a complete TNetstring, the payload is cut after TNETSTRING_DATA_MAXLEN */
+	void prepend_tnetstring(const char* msg, std::size_t len, const char tag) {
+		if (static_cast<std::size_t>(TNETSTRING_DATA_MAXLEN) < len) {
+			len = TNETSTRING_DATA_MAXLEN;
+		}
+		prepend(tag);
+		prepend(msg, len);
+		prepend_size(len);
+	}
+
+private:
+
+	/** Output buffer, the encoded bytes are at its end */
+	std::vector<char> buffer_;
+
+	/** Index of the first encoded byte */
+	std::size_t begin_;
+
+	/** Makes room for count more bytes in front of the encoded ones */
+	void reserve(std::size_t count) {
+		if (begin_ >= count) {
+			return;
+		}
+		const std::size_t used = size();
+		std::size_t capacity = buffer_.size() > 256 ? 2 * buffer_.size() : 256;
+		while (capacity < used + count) {
+			capacity *= 2;
+		}
+		std::vector<char> buffer(capacity);
+		if (used > 0) {
+			std::memcpy(&buffer[capacity - used], data(), used);
+		}
+		buffer_.swap(buffer);
+		begin_ = capacity - used;
+	}
+
+};
+
+/**
+ * Throws if the view has not the expected type
+ *
+ * @throw tnetstring::Type_exception
+ */
+inline void check_typed(const View& view, char expected) {
+	if (view.type() != expected) {
+		Type_exception e;
+		e << Error_msg_info("TNetstring value has an unexpected type");
+		e << Parse_char_info(view.type());
+		BOOST_THROW_EXCEPTION(e);
+	}
+}
+
+/**
+ * Key of the dict element at it, it is advanced to the value
+ *
+ * @throw tnetstring::Parse_exception
+ */
+inline boost::string_view typed_key(View::const_iterator& it, const View::const_iterator& end_it) {
+	if (it->type() != TNETSTRING_TAG_STRING) {
+		Parse_exception e;
+		e << Error_msg_info("dict key must be of type string");
+		BOOST_THROW_EXCEPTION(e);
+	}
+	const boost::string_view key = it->payload();
+
+	// every key is followed by its value
+	if (++it == end_it) {
+		Parse_exception e;
+		e << Error_msg_info("Premature end of TNetstring");
+		BOOST_THROW_EXCEPTION(e);
+	}
+	return key;
+}
+
+/**
+ * Encoding and decoding of a C++ type.
+ * Specialised for the scalars, std::string, std::vector, std::map with string keys
+ * and boost::optional. The primary template handles structs declared with
+ * TNETSTRING_FIELDS as dicts.
+ */
+template <typename T, typename Enable = void>
+struct Codec {
+
+	/** Encodes value as dict of its fields */
+	static void encode(Typed_encoder& encoder, const T& value) {
+		encoder.prepend(TNETSTRING_TAG_DICT);
+		const std::size_t payload_end = encoder.size();
+		tnetstring_encode_fields(encoder, value);
+		encoder.prepend_container_size(encoder.size() - payload_end);
+	}
+
+	/**
+	 * Decodes the fields of value from a dict. Unknown keys are skipped,
+	 * fields missing from the dict keep their values, fields given more than
+	 * once keep their first value like dicts do.
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	static void decode(const View& view, T& value) {
+		check_typed(view, TNETSTRING_TAG_DICT);
+		std::size_t next_field = 0;
+		Decoded_fields decoded;
+		const View::const_iterator end_it = view.end();
+		for (View::const_iterator it = view.begin(); it != end_it; ++it) {
+			const boost::string_view key = typed_key(it, end_it);
+			next_field = tnetstring_decode_field(value, key, *it, next_field, decoded);
+		}
+	}
+};
+
+template <>
+struct Codec<int> {
+	static void encode(Typed_encoder& encoder, int value) {
+		char msg[INT_FORMAT_MAXLEN];
+		encoder.prepend_tnetstring(msg, format_int(value, msg), TNETSTRING_TAG_INT);
+	}
+
+	static void decode(const View& view, int& value) {
+		value = view.as_int();
+	}
+};
+
+template <>
+struct Codec<std::int64_t> {
+	static void encode(Typed_encoder& encoder, std::int64_t value) {
+		char msg[INT64_FORMAT_MAXLEN];
+		encoder.prepend_tnetstring(msg, format_int64(value, msg), TNETSTRING_TAG_INT);
+	}
+
+	static void decode(const View& view, std::int64_t& value) {
+		value = view.as_int64();
+	}
+};
+
+template <>
+struct Codec<std::uint64_t> {
+	static void encode(Typed_encoder& encoder, std::uint64_t value) {
+		char msg[INT64_FORMAT_MAXLEN];
+		encoder.prepend_tnetstring(msg, format_uint64(value, msg), TNETSTRING_TAG_INT);
+	}
+
+	static void decode(const View& view, std::uint64_t& value) {
+		value = view.as_uint64();
+	}
+};
+
+template <>
+struct Codec<double> {
+	static void encode(Typed_encoder& encoder, double value) {
+		char msg[DOUBLE_FORMAT_MAXLEN];
+		encoder.prepend_tnetstring(msg, format_double(value, msg), TNETSTRING_TAG_FLOAT);
+	}
+
+	static void decode(const View& view, double& value) {
+		value = view.as_double();
+	}
+};
+
+template <>
+struct Codec<bool> {
+	static void encode(Typed_encoder& encoder, bool value) {
+		if (value) {
+			encoder.prepend_tnetstring("true", 4, TNETSTRING_TAG_BOOLEAN);
+		} else {
+			encoder.prepend_tnetstring("false", 5, TNETSTRING_TAG_BOOLEAN);
+		}
+	}
+
+	static void decode(const View& view, bool& value) {
+		value = view.as_bool();
+	}
+};
+
+template <>
+struct Codec<std::string> {
+	static void encode(Typed_encoder& encoder, const std::string& value) {
+		encoder.prepend_tnetstring(value.data(), value.size(), TNETSTRING_TAG_STRING);
+	}
+
+	static void decode(const View& view, std::string& value) {
+		const boost::string_view payload = view.as_string_view();
+		value.assign(payload.data(), payload.size());
+	}
+};
+
+/** Lists, decoding replaces the elements */
+template <typename T>
+struct Codec<std::vector<T> > {
+	static void encode(Typed_encoder& encoder, const std::vector<T>& value) {
+		encoder.prepend(TNETSTRING_TAG_LIST);
+		const std::size_t payload_end = encoder.size();
+		for (typename std::vector<T>::const_reverse_iterator i = value.rbegin(); i != value.rend(); ++i) {
+			Codec<T>::encode(encoder, *i);
+		}
+		encoder.prepend_container_size(encoder.size() - payload_end);
+	}
+
+	static void decode(const View& view, std::vector<T>& value) {
+		check_typed(view, TNETSTRING_TAG_LIST);
+		value.clear();
+		for (const View& element : view) {
+			value.emplace_back();
+			Codec<T>::decode(element, value.back());
+		}
+	}
+};
+
+/** Dicts, decoding replaces the elements and keeps the first of duplicate keys */
+template <typename T>
+struct Codec<std::map<std::string, T> > {
+	static void encode(Typed_encoder& encoder, const std::map<std::string, T>& value) {
+		encoder.prepend(TNETSTRING_TAG_DICT);
+		const std::size_t payload_end = encoder.size();
+		for (typename std::map<std::string, T>::const_reverse_iterator i = value.rbegin(); i != value.rend(); ++i) {
+			Codec<T>::encode(encoder, i->second);
+			encoder.prepend_tnetstring(i->first.data(), i->first.size(), TNETSTRING_TAG_STRING);
+		}
+		encoder.prepend_container_size(encoder.size() - payload_end);
+	}
+
+	static void decode(const View& view, std::map<std::string, T>& value) {
+		check_typed(view, TNETSTRING_TAG_DICT);
+		value.clear();
+		const View::const_iterator end_it = view.end();
+		for (View::const_iterator it = view.begin(); it != end_it; ++it) {
+			const boost::string_view key = typed_key(it, end_it);
+			std::pair<typename std::map<std::string, T>::iterator, bool> inserted =
+					value.emplace(std::string(key.data(), key.size()), T());
+			if (inserted.second) {
+				Codec<T>::decode(*it, inserted.first->second);
+			}
+		}
+	}
+};
+
+/** Optional values, none is encoded as null */
+template <typename T>
+struct Codec<boost::optional<T> > {
+	static void encode(Typed_encoder& encoder, const boost::optional<T>& value) {
+		if (value) {
+			Codec<T>::encode(encoder, *value);
+		} else {
+			encoder.prepend(TNETSTRING_NULL.data(), TNETSTRING_NULL.size());
+		}
+	}
+
+	static void decode(const View& view, boost::optional<T>& value) {
+		if (view.is_null()) {
+			value = boost::none;
+		} else {
+			value = T();
+			Codec<T>::decode(view, *value);
+		}
+	}
+};
+
+template <typename T>
+boost::string_view Typed_encoder::encode(const T& value) {
+	begin_ = buffer_.size();
+	Codec<T>::encode(*this, value);
+	return boost::string_view(data(), size());
+}
+
+/**
+ * Decodes the TNetstring at the beginning of the buffer into value, see Codec
+ *
+ * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+ * @return count of bytes consumed from the buffer
+ */
+template <typename T>
+std::size_t decode_typed(const char* data, std::size_t size, T& value) {
+	const View view(data, size);
+	Codec<T>::decode(view, value);
+	return view.size();
+}
+
+/**
+ * Decodes the TNetstring at the beginning of the string into value, see Codec
+ *
+ * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+ * @return count of bytes consumed from the string
+ */
+template <typename T>
+std::size_t decode_typed(const std::string& data, T& value) {
+	return decode_typed(data.data(), data.size(), value);
+}
+
+} // ::tnetstring
+
+/** Encodes one field, see TNETSTRING_FIELDS */
+#define TNETSTRING_DETAIL_ENCODE_FIELD(r, value, field) \
+	::tnetstring::Codec<decltype(value.field)>::encode(encoder, value.field); \
+	encoder.prepend_tnetstring(BOOST_PP_STRINGIZE(field), sizeof(BOOST_PP_STRINGIZE(field)) - 1, \
+			::tnetstring::TNETSTRING_TAG_STRING);
+
+/** Decodes the i-th field if key is its name and it is not yet decoded, see TNETSTRING_FIELDS */
+#define TNETSTRING_DETAIL_DECODE_FIELD(r, value, i, field) \
+	if (key == ::boost::string_view(BOOST_PP_STRINGIZE(field), sizeof(BOOST_PP_STRINGIZE(field)) - 1)) { \
+		if (!decoded.test(i)) { \
+			decoded.set(i); \
+			::tnetstring::Codec<decltype(value.field)>::decode(field_value, value.field); \
+		} \
+		return i + 1; \
+	}
+
+/** Case of the i-th field in the switch over the expected field, see TNETSTRING_FIELDS */
+#define TNETSTRING_DETAIL_EXPECT_FIELD(r, value, i, field) \
+	case i: TNETSTRING_DETAIL_DECODE_FIELD(r, value, i, field) break;
+
+/**
+ * Declares the fields of a struct to encode and decode it as dict with Typed_encoder
+ * and decode_typed(), e.g. TNETSTRING_FIELDS(Quote, symbol, bid, ask).
+ * Use it in the namespace of the struct, the fields have to be public and of types
+ * supported by Codec. The fields are encoded in the order given.
+ *
+ * Keys are matched by code generated for the struct: the field following the
+ * previously decoded one is tried first, so fields encoded in order are matched
+ * with a single comparison, then all field names are compared.
+ */
+#define TNETSTRING_FIELDS(Struct, ...) \
+	inline void tnetstring_encode_fields(::tnetstring::Typed_encoder& encoder, const Struct& value) { \
+		BOOST_PP_SEQ_FOR_EACH(TNETSTRING_DETAIL_ENCODE_FIELD, value, \
+				BOOST_PP_SEQ_REVERSE(BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__))) \
+	} \
+	inline std::size_t tnetstring_decode_field(Struct& value, ::boost::string_view key, \
+			const ::tnetstring::View& field_value, std::size_t next_field, \
+			::tnetstring::Decoded_fields& decoded) { \
+		switch (next_field) { \
+			BOOST_PP_SEQ_FOR_EACH_I(TNETSTRING_DETAIL_EXPECT_FIELD, value, BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__)) \
+			default: break; \
+		} \
+		BOOST_PP_SEQ_FOR_EACH_I(TNETSTRING_DETAIL_DECODE_FIELD, value, BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__)) \
+		return next_field; \
+	}
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -25,6 +27,8 @@ namespace tnetstring {
 typedef boost::make_recursive_variant<
 	const char*
 	, int
+	, std::int64_t
+	, std::uint64_t
 	, std::string
 	, double
 	, bool
@@ -42,5 +46,50 @@ typedef std::vector<TNetstring_value> TNetstring_list;
  */
 typedef std::map<std::string, TNetstring_value> TNetstring_dict;
 
+/**
+ * Decoded tree allocated from the global heap.
+ * Tree types name the value, string, list and dict types a decoder builds and
+ * create their empty instances.
+ */
+class Heap_tree {
+public:
+	typedef TNetstring_value value_type;
+	typedef std::string string_type;
+	typedef TNetstring_list list_type;
+	typedef TNetstring_dict dict_type;
+	typedef std::string key_type;
+
+	/** New string payload */
+	string_type string(const char* data, std::size_t size) const {
+		return string_type(data, size);
+	}
+
+	/** New dict key */
+	key_type key(const char* data, std::size_t size) const {
+		return key_type(data, size);
+	}
+
+	/** New empty list */
+	list_type list() const {
+		return list_type();
+	}
+
+	/** New empty dict, payload_size is the size of its encoded payload */
+	dict_type dict(std::size_t /* payload_size */ = 0) const {
+		return dict_type();
+	}
+};
+
+/**
+ * Selects the type TNetstring integers are decoded to.
+ */
+enum Int_mode {
+	/** The narrowest of int, std::int64_t and std::uint64_t the integer fits into */
+	INT_NARROWEST,
+
+	/** std::int64_t, or std::uint64_t for integers beyond its range */
+	INT_64
+};
+
 }  // ::tnetstring
 
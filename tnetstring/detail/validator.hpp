@@ -0,0 +1,274 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+namespace tnetstring {
+
+/** Default maximum nesting depth of lists and dicts accepted by validate() */
+const std::size_t VALIDATE_DEPTH_MAX = 512;
+
+/**
+ * Result of validate()
+ */
+struct Validate_result {
+	/** True if the data starts with a valid TNetstring */
+	bool ok;
+
+	/** Size of the valid TNetstring, or offset of the first offending byte from the beginning of the data */
+	std::size_t position;
+
+	/** Description of the first error, the message a decoder would throw, or nullptr if valid */
+	const char* error;
+};
+
+/**
+ * Validator.
+ * Checks untrusted TNetstrings without decoding nor allocating: size fields,
+ * type characters, nesting bounds, dict keys, boolean payloads and the syntax
+ * and range of numeric payloads. Digit runs are classified with SSE2 where
+ * available, see leading_digits(). Containers are validated recursively, the
+ * nesting depth is limited to keep crafted input from exhausting the stack.
+ */
+class Validator {
+public:
+
+	/**
+	 * CTOR
+	 *
+	 * @param data buffer to validate
+	 * @param size size of the buffer
+	 * @param max_depth maximum nesting depth of lists and dicts, the outermost one has depth 1
+	 */
+	Validator(const char* data, std::size_t size, std::size_t max_depth = VALIDATE_DEPTH_MAX)
+		: begin_(data), pos_(data), end_(data + size), error_(nullptr), error_pos_(nullptr),
+		  max_depth_(max_depth), depth_(0) {};
+
+	/** DTOR */
+	virtual ~Validator() {};
+
+	/** Validates the TNetstring at the beginning of the buffer */
+	Validate_result validate() {
+		Validate_result result;
+		result.ok = validate_element(end_, false);
+		result.position = result.ok ? pos_ - begin_ : error_pos_ - begin_;
+		result.error = error_;
+		return result;
+	}
+
+private:
+
+	/** Beginning of the buffer */
+	const char* begin_;
+
+	/** Cursor, all the methods read from here */
+	const char* pos_;
+
+	/** End of the buffer (one past the last character) */
+	const char* end_;
+
+	/** First error */
+	const char* error_;
+
+	/** Offending byte of the first error */
+	const char* error_pos_;
+
+	/** Maximum nesting depth of lists and dicts */
+	const std::size_t max_depth_;
+
+	/** Count of lists and dicts enclosing the cursor */
+	std::size_t depth_;
+
+	/** Records the first error, always false */
+	bool fail(const char* error, const char* error_pos) {
+		error_ = error;
+		error_pos_ = error_pos;
+		return false;
+	}
+
+	/**
+	 * (Recursively) validates the TNetstring at the cursor, which is advanced behind it if valid
+	 *
+	 * @param container_end end of the payload of the enclosing container, or of the buffer
+	 * @param nested whether the TNetstring is an element of a container
+	 * @param key whether the TNetstring is a dict key
+	 */
+	bool validate_element(const char* container_end, bool nested, bool key = false) {
+		// SIZE
+		const char* size_end = container_end;
+		if (size_end - pos_ > TNETSTRING_SIZE_MAXLEN) {
+			size_end = pos_ + TNETSTRING_SIZE_MAXLEN + 1;
+		}
+		const std::size_t size_length = leading_digits(pos_, size_end);
+
+		if (size_length > static_cast<std::size_t>(TNETSTRING_SIZE_MAXLEN)) {
+			return fail("TNetstring size field is too large", pos_ + TNETSTRING_SIZE_MAXLEN);
+		} else if (pos_ + size_length == container_end) {
+			return fail("Premature end of TNetstring", container_end);
+		} else if (pos_[size_length] != TNETSTRING_SIZE_DELIM) {
+			return fail("TNetstring size field is not a digit", pos_ + size_length);
+		} else if (size_length == 0) {
+			return fail("TNetstring size field is not an integer.", pos_);
+		}
+
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < size_length; i++) {
+			size = size * 10 + (pos_[i] - '0');
+		}
+		const char* payload = pos_ + size_length + 1;
+
+		// BOUNDS
+		if (static_cast<std::size_t>(container_end - payload) <= size) {
+			return fail(nested ? "TNetstring element exceeds its container" : "Premature end of TNetstring", pos_);
+		}
+
+		// TYPE and PAYLOAD
+		const char* payload_end = payload + size;
+		const char tag = *payload_end;
+		if (key && tag != TNETSTRING_TAG_STRING) {
+			return fail("dict key must be of type string", payload_end);
+		}
+
+		switch (tag) {
+			case TNETSTRING_TAG_STRING:
+			case TNETSTRING_TAG_NULL:
+				break;
+
+			case TNETSTRING_TAG_INT:
+				if (!valid_int(payload, size)) {
+					return fail("TNetstring payload cannot be casted to int", payload);
+				}
+				break;
+
+			case TNETSTRING_TAG_FLOAT:
+				if (!valid_double(payload, size)) {
+					return fail("TNetstring payload cannot be casted to double", payload);
+				}
+				break;
+
+			case TNETSTRING_TAG_BOOLEAN:
+				if (!((size == 4 && std::memcmp(payload, "true", 4) == 0) ||
+				      (size == 5 && std::memcmp(payload, "false", 5) == 0))) {
+					return fail("TNetstring payload is no boolean", payload);
+				}
+				break;
+
+			case TNETSTRING_TAG_LIST:
+				if (++depth_ > max_depth_) {
+					return fail("TNetstring nesting is too deep", pos_);
+				}
+				pos_ = payload;
+				while (pos_ < payload_end) {
+					if (!validate_element(payload_end, true)) {
+						return false;
+					}
+				}
+				depth_--;
+				break;
+
+			case TNETSTRING_TAG_DICT:
+				if (++depth_ > max_depth_) {
+					return fail("TNetstring nesting is too deep", pos_);
+				}
+				pos_ = payload;
+				while (pos_ < payload_end) {
+					if (!validate_element(payload_end, true, true)) {
+						return false;
+					}
+					if (pos_ == payload_end) {
+						return fail("Premature end of TNetstring", payload_end);
+					}
+					if (!validate_element(payload_end, true)) {
+						return false;
+					}
+				}
+				depth_--;
+				break;
+
+			default:
+				return fail("Illegal or unsupported TNetstring payload type", payload_end);
+		}
+
+		pos_ = payload_end + 1;
+		return true;
+	}
+
+	/** Checks an integer payload the way parse_integer() parses it */
+	static bool valid_int(const char* payload, std::size_t size) {
+		const std::size_t sign = (size > 0 && (payload[0] == '-' || payload[0] == '+')) ? 1 : 0;
+		const std::size_t digits = leading_digits(payload + sign, payload + size);
+		if (digits == 0 || sign + digits != size) {
+			return false;
+		}
+
+		// up to 18 digits always fit, longer ones are range checked
+		if (digits <= 18) {
+			return true;
+		}
+		std::int64_t int64_val;
+		std::uint64_t uint64_val;
+		return parse_int64(payload, size, int64_val) || parse_uint64(payload, size, uint64_val);
+	}
+
+	/**
+	 * Checks a double payload the way parse_double() parses it.
+	 * Plain decimal numbers are checked directly, anything else strtod accepts,
+	 * like inf, nan or hex floats, is left to parse_double() if it is short.
+	 */
+	static bool valid_double(const char* payload, std::size_t size) {
+		const char* pos = payload;
+		const char* end = payload + size;
+
+		if (pos != end && (*pos == '-' || *pos == '+')) {
+			pos++;
+		}
+		std::size_t mantissa_digits = leading_digits(pos, end);
+		pos += mantissa_digits;
+		if (pos != end && *pos == '.') {
+			pos++;
+			const std::size_t fraction_digits = leading_digits(pos, end);
+			mantissa_digits += fraction_digits;
+			pos += fraction_digits;
+		}
+		if (mantissa_digits > 0 && pos != end && (*pos == 'e' || *pos == 'E')) {
+			const char* exponent = pos + 1;
+			if (exponent != end && (*exponent == '-' || *exponent == '+')) {
+				exponent++;
+			}
+			const std::size_t exponent_digits = leading_digits(exponent, end);
+			if (exponent_digits > 0) {
+				pos = exponent + exponent_digits;
+			}
+		}
+		if (mantissa_digits > 0 && pos == end) {
+			return true;
+		}
+
+		double double_val;
+		return size < static_cast<std::size_t>(DOUBLE_FORMAT_MAXLEN) && parse_double(payload, size, double_val);
+	}
+
+};
+
+/**
+ * Validates the TNetstring at the beginning of the buffer without decoding nor allocating
+ *
+ * @param data buffer to validate
+ * @param size size of the buffer
+ * @param max_depth maximum nesting depth of lists and dicts
+ * @return size of the TNetstring, or the offset and description of the first error
+ */
+inline Validate_result validate(const char* data, std::size_t size, std::size_t max_depth = VALIDATE_DEPTH_MAX) {
+	Validator validator(data, size, max_depth);
+	return validator.validate();
+}
+
+} // ::tnetstring
@@ -0,0 +1,442 @@
+
+//          Copyright Marc Bodmer 2011-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+
+namespace tnetstring {
+
+/**
+ * Read-only view of an encoded TNetstring.
+ *
+ * A View points into the original bytes and never allocates. Only the
+ * size field and the type character of the viewed TNetstring are checked
+ * on construction, nested values are parsed when they are accessed.
+ * Call validate() to check the complete TNetstring up front.
+ *
+ * The viewed buffer is not copied, it has to outlive the view.
+ */
+class View {
+public:
+
+	class const_iterator;
+
+	/** CTOR, creates an invalid view (e.g. the result of an unsuccessful find) */
+	View() : payload_(nullptr), payload_size_(0), size_digits_(0), type_('\0') {};
+
+	/**
+	 * CTOR, views the TNetstring at the beginning of the buffer
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	View(const char* data, std::size_t size)
+		: payload_(nullptr), payload_size_(0), size_digits_(0), type_('\0') {
+		parse_header(data, size);
+	};
+
+	/**
+	 * CTOR, views the TNetstring at the beginning of the string
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	explicit View(const std::string& data) : View(data.data(), data.size()) {};
+
+	/** False for invalid views */
+	explicit operator bool() const {
+		return payload_ != nullptr;
+	}
+
+	/** Type character of the viewed TNetstring */
+	char type() const {
+		return type_;
+	}
+
+	/** Count of bytes the viewed TNetstring occupies (size field, payload and type) */
+	std::size_t size() const {
+		return size_digits_ + 1 + payload_size_ + 1;
+	}
+
+	/** First byte of the viewed TNetstring */
+	const char* data() const {
+		return payload_ - size_digits_ - 1;
+	}
+
+	/** Raw payload of the viewed TNetstring */
+	boost::string_view payload() const {
+		return boost::string_view(payload_, payload_size_);
+	}
+
+	/** True if the viewed TNetstring is null */
+	bool is_null() const {
+		return type_ == TNETSTRING_TAG_NULL;
+	}
+
+	/**
+	 * String payload
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	boost::string_view as_string_view() const {
+		check_type(TNETSTRING_TAG_STRING);
+		return payload();
+	}
+
+	/**
+	 * Integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	int as_int() const {
+		check_type(TNETSTRING_TAG_INT);
+		int int_val;
+		if (!parse_int(payload_, payload_size_, int_val)) {
+			Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int");
+			e << Parse_value_info(std::string(payload_, payload_size_));
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return int_val;
+	}
+
+	/**
+	 * 64 bit integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	std::int64_t as_int64() const {
+		check_type(TNETSTRING_TAG_INT);
+		std::int64_t int64_val;
+		if (!parse_int64(payload_, payload_size_, int64_val)) {
+			Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int64");
+			e << Parse_value_info(std::string(payload_, payload_size_));
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return int64_val;
+	}
+
+	/**
+	 * Unsigned 64 bit integer payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	std::uint64_t as_uint64() const {
+		check_type(TNETSTRING_TAG_INT);
+		std::uint64_t uint64_val;
+		if (!parse_uint64(payload_, payload_size_, uint64_val)) {
+			Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to uint64");
+			e << Parse_value_info(std::string(payload_, payload_size_));
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return uint64_val;
+	}
+
+	/**
+	 * Float payload
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	double as_double() const {
+		check_type(TNETSTRING_TAG_FLOAT);
+		double double_val;
+		if (!parse_double(payload_, payload_size_, double_val)) {
+			Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to double");
+			e << Parse_value_info(std::string(payload_, payload_size_));
+			BOOST_THROW_EXCEPTION(e);
+		}
+		return double_val;
+	}
+
+	/**
+	 * Boolean payload
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	bool as_bool() const {
+		check_type(TNETSTRING_TAG_BOOLEAN);
+		return payload() == "true";
+	}
+
+	/**
+	 * First element of a list or dict, dict elements alternate between key and value
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * End of the elements of a list or dict
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	const_iterator end() const;
+
+	/**
+	 * Looks up a key of the viewed dict, keys are compared until the first match
+	 *
+	 * @throw tnetstring::Type_exception, tnetstring::Parse_exception
+	 * @return view of the value or an invalid view if the key was not found
+	 */
+	View find(boost::string_view key) const;
+
+	/**
+	 * Recursively checks the complete viewed TNetstring
+	 *
+	 * @throw tnetstring::Parse_exception, also if lists and dicts are nested deeper than max_depth
+	 * @param max_depth nesting depth of lists and dicts accepted, see validate()
+	 */
+	void validate(std::size_t max_depth = VALIDATE_DEPTH_MAX) const;
+
+private:
+
+	/** First payload byte */
+	const char* payload_;
+
+	/** Payload size as given by the size field */
+	std::size_t payload_size_;
+
+	/** Count of size field digits */
+	std::size_t size_digits_;
+
+	/** Type character */
+	char type_;
+
+	/**
+	 * Parses and checks size field and type character
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	void parse_header(const char* data, std::size_t size) {
+		std::size_t payload_size = 0;
+		const std::size_t size_length = parse_size(data, data + size, payload_size);
+
+		if (size_length == 0) {
+			throw_size_exception(data, data + size);
+		}
+
+		// size field, delimiter, payload and type character have to fit into the buffer
+		if (size - size_length - 1 <= payload_size) {
+			Parse_exception e = create_parse_exception("Premature end of TNetstring");
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		const char c = data[size_length + 1 + payload_size];
+
+		if (!(c == TNETSTRING_TAG_STRING  || c == TNETSTRING_TAG_INT     ||
+			  c == TNETSTRING_TAG_FLOAT   || c == TNETSTRING_TAG_BOOLEAN ||
+			  c == TNETSTRING_TAG_NULL    || c == TNETSTRING_TAG_DICT    ||
+			  c == TNETSTRING_TAG_LIST))
+		{
+			Parse_exception e =
+					create_parse_exception("Illegal or unsupported TNetstring payload type");
+			e << Parse_char_info(c);
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		payload_ = data + size_length + 1;
+		payload_size_ = payload_size;
+		size_digits_ = size_length;
+		type_ = c;
+	}
+
+	/**
+	 * Throws if the viewed TNetstring is not of the expected type
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	void check_type(char expected) const {
+		if (type_ != expected) {
+			Type_exception e;
+			e << Error_msg_info("TNetstring value has an unexpected type");
+			e << Parse_char_info(type_);
+			BOOST_THROW_EXCEPTION(e);
+		}
+	}
+
+	/**
+	 * Throws if the viewed TNetstring is neither a list nor a dict
+	 *
+	 * @throw tnetstring::Type_exception
+	 */
+	void check_container() const {
+		if (type_ != TNETSTRING_TAG_LIST && type_ != TNETSTRING_TAG_DICT) {
+			Type_exception e;
+			e << Error_msg_info("TNetstring value is not a container");
+			e << Parse_char_info(type_);
+			BOOST_THROW_EXCEPTION(e);
+		}
+	}
+};
+
+
+/**
+ * Forward iterator over the elements of a viewed list or dict.
+ * Every increment parses the header of the next element only.
+ */
+class View::const_iterator {
+public:
+
+	typedef std::forward_iterator_tag iterator_category;
+	typedef View value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const View* pointer;
+	typedef const View& reference;
+
+	/** CTOR */
+	const_iterator() : container_end_(nullptr) {};
+
+	/**
+	 * CTOR, positions the iterator on the element starting at pos
+	 *
+	 * @throw tnetstring::Parse_exception
+	 */
+	const_iterator(const char* pos, const char* container_end) : container_end_(container_end) {
+		if (pos != container_end) {
+			current_ = View(pos, container_end - pos);
+		}
+	};
+
+	const View& operator*() const { return current_; }
+
+	const View* operator->() const { return &current_; }
+
+	/** @throw tnetstring::Parse_exception */
+	const_iterator& operator++() {
+		const char* pos = current_.data() + current_.size();
+		current_ = (pos != container_end_) ? View(pos, container_end_ - pos) : View();
+		return *this;
+	}
+
+	/** @throw tnetstring::Parse_exception */
+	const_iterator operator++(int) {
+		const_iterator old = *this;
+		++(*this);
+		return old;
+	}
+
+	bool operator==(const const_iterator& other) const {
+		return current_.payload_ == other.current_.payload_;
+	}
+
+	bool operator!=(const const_iterator& other) const {
+		return !(*this == other);
+	}
+
+private:
+	/** Currently viewed element, invalid at the end */
+	View current_;
+
+	/** End of the container payload */
+	const char* container_end_;
+};
+
+
+inline View::const_iterator View::begin() const {
+	check_container();
+	return const_iterator(payload_, payload_ + payload_size_);
+}
+
+inline View::const_iterator View::end() const {
+	check_container();
+	return const_iterator(payload_ + payload_size_, payload_ + payload_size_);
+}
+
+inline View View::find(boost::string_view key) const {
+	check_type(TNETSTRING_TAG_DICT);
+
+	const_iterator end_it = end();
+	for (const_iterator it = begin(); it != end_it; ++it) {
+		if (it->type() != TNETSTRING_TAG_STRING) {
+			Parse_exception e = create_parse_exception("dict key must be of type string");
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		const bool match = (it->payload() == key);
+
+		// every key is followed by its value
+		if (++it == end_it) {
+			Parse_exception e = create_parse_exception("Premature end of TNetstring");
+			BOOST_THROW_EXCEPTION(e);
+		}
+
+		if (match) {
+			return *it;
+		}
+	}
+
+	return View();
+}
+
+inline void View::validate(std::size_t max_depth) const {
+	if ((type_ == TNETSTRING_TAG_LIST || type_ == TNETSTRING_TAG_DICT) && max_depth == 0) {
+		Parse_exception e = create_parse_exception("TNetstring nesting is too deep");
+		BOOST_THROW_EXCEPTION(e);
+	}
+
+	switch (type_) {
+		case TNETSTRING_TAG_INT: {
+			TNetstring_value int_val;
+			if (!parse_integer(payload_, payload_size_, INT_NARROWEST, int_val)) {
+				Parse_exception e = create_parse_exception("TNetstring payload cannot be casted to int");
+				e << Parse_value_info(std::string(payload_, payload_size_));
+				BOOST_THROW_EXCEPTION(e);
+			}
+		}; break;
+
+		case TNETSTRING_TAG_FLOAT: {
+			as_double();
+		}; break;
+
+		case TNETSTRING_TAG_BOOLEAN: {
+			if (payload() != "true" && payload() != "false") {
+				Parse_exception e = create_parse_exception("TNetstring payload is not a boolean");
+				e << Parse_value_info(std::string(payload_, payload_size_));
+				BOOST_THROW_EXCEPTION(e);
+			}
+		}; break;
+
+		case TNETSTRING_TAG_NULL: {
+			if (payload_size_ != 0) {
+				Parse_exception e = create_parse_exception("TNetstring null has a payload");
+				e << Parse_value_info(std::string(payload_, payload_size_));
+				BOOST_THROW_EXCEPTION(e);
+			}
+		}; break;
+
+		case TNETSTRING_TAG_LIST: {
+			for (const_iterator it = begin(), end_it = end(); it != end_it; ++it) {
+				it->validate(max_depth - 1);
+			}
+		}; break;
+
+		case TNETSTRING_TAG_DICT: {
+			bool is_key = true;
+			for (const_iterator it = begin(), end_it = end(); it != end_it; ++it) {
+				if (is_key && it->type() != TNETSTRING_TAG_STRING) {
+					Parse_exception e = create_parse_exception("dict key must be of type string");
+					BOOST_THROW_EXCEPTION(e);
+				}
+				it->validate(max_depth - 1);
+				is_key = !is_key;
+			}
+			if (!is_key) {
+				Parse_exception e = create_parse_exception("dict key without value");
+				BOOST_THROW_EXCEPTION(e);
+			}
+		}; break;
+
+		default:
+			break;
+	}
+}
+
+} // ::tnetstring